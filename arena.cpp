@@ -0,0 +1,29 @@
+// arena.cpp
+#include "arena.h"
+
+void* Arena::allocate(size_t size, size_t align) {
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        size_t start = (used + align - 1) & ~(align - 1);
+        if (start + size <= block.size) {
+            used = start + size;
+            return block.data.get() + start;
+        }
+        // Move on to the next retained block, if any
+        current++;
+        used = 0;
+    }
+
+    // Fresh blocks come from operator new[] and are aligned for any
+    // fundamental type, so offsets only need aligning within a block
+    size_t blockSize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+    blocks.push_back(Block{std::unique_ptr<char[]>(new char[blockSize]), blockSize});
+    current = blocks.size() - 1;
+    used = size;
+    return blocks.back().data.get();
+}
+
+void Arena::reset() {
+    current = 0;
+    used = 0;
+}
@@ -0,0 +1,30 @@
+// arena.h
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for per-compilation data. Memory comes from a few large
+// blocks and is never freed individually; reset() releases everything at
+// once while keeping the blocks for the next compilation.
+class Arena {
+    static constexpr size_t BLOCK_SIZE = 256 * 1024;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0; // block being bumped
+    size_t used = 0;    // bytes used in that block
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // align must not exceed alignof(std::max_align_t)
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+    void reset();
+};
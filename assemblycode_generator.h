@@ -0,0 +1,11 @@
+// assemblycode_generator.h
+#pragma once
+#include "interner.h"
+#include "machine_ir.h"
+#include "tac.h"
+#include <ostream>
+
+// Lowers TAC to x86-64 machine code: linear-scan register allocation,
+// instruction selection and the peephole pass. Allocation and peephole
+// statistics go to report when given.
+MachineCode generateAssembly(const TacCode& code, const Interner& interner, std::ostream* report = nullptr);
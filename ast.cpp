@@ -0,0 +1,15 @@
+// ast.cpp
+#include "ast.h"
+
+Ast::Ast(Arena& arena) : arena(arena) {
+    add(NodeKind::Block, Type::None, 0); // node 0 is the "no node" sentinel
+}
+
+NodeId Ast::add(NodeKind kind, Type type, SymbolId value, NodeId a, NodeId b, NodeId c, NodeId d) {
+    if ((count & (CHUNK_SIZE - 1)) == 0) {
+        chunks.push_back(static_cast<Node*>(arena.allocate(sizeof(Node) * CHUNK_SIZE, alignof(Node))));
+    }
+    NodeId id = count++;
+    (*this)[id] = Node{kind, type, value, a, b, c, d, 0};
+    return id;
+}
@@ -0,0 +1,67 @@
+// ast.h
+#pragma once
+#include "arena.h"
+#include "interner.h"
+#include "symbol_table.h"
+#include <vector>
+
+using NodeId = uint32_t; // 0 means "no node"
+
+enum class NodeKind : uint8_t {
+    // Statements
+    Block,    // a = first statement
+    VarDecl,  // value = name, a = initializer, d = declared VarId
+    Assign,   // value = name, a = value, d = target VarId
+    If,       // a = condition, b = then block, c = else block (or 0)
+    While,    // a = condition, b = body
+    For,      // a = init statement, b = condition, c = update statement, d = body
+    Print,    // a = operand
+
+    // Expressions
+    Literal,  // value = literal spelling
+    Variable, // value = variable name, d = resolved VarId
+    Binary,   // value = operator spelling (+ - * / < > <= >= == !=), a/b = operands
+    And,      // short-circuit &&, a/b = operands
+    Or        // short-circuit ||, a/b = operands
+};
+
+// Children are node indices rather than pointers; statements in a block
+// are chained through next.
+struct Node {
+    NodeKind kind;
+    Type type;
+    SymbolId value;
+    NodeId a, b, c, d;
+    NodeId next;
+};
+
+// One entry per declaration. Shadowing declarations of the same name get
+// distinct IR spellings ("x", "x.1", ...) so lowered code stays unambiguous.
+struct VarInfo {
+    SymbolId name;
+    SymbolId irName;
+    Type type;
+};
+
+// Nodes live in fixed-size chunks bump-allocated from the compilation's
+// Arena, so building a tree costs a handful of large allocations and
+// tearing it down is an Arena::reset().
+class Ast {
+    static constexpr uint32_t CHUNK_BITS = 12;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+
+    Arena& arena;
+    std::vector<Node*> chunks;
+    uint32_t count = 0;
+
+public:
+    std::vector<VarInfo> vars; // indexed by VarId
+
+    explicit Ast(Arena& arena);
+
+    NodeId add(NodeKind kind, Type type, SymbolId value, NodeId a = 0, NodeId b = 0, NodeId c = 0, NodeId d = 0);
+
+    Node& operator[](NodeId id) { return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)]; }
+    const Node& operator[](NodeId id) const { return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)]; }
+    uint32_t size() const { return count; }
+};
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Generates one program of loops and branches per size and times the CFG,
+# dominator, liveness, reaching-definitions and SSA analyses on its
+# unoptimized TAC (--bench-analysis), then the whole -O2 compile. Time per
+# instruction should stay roughly flat up to a million instructions. Every
+# name is also assigned unconditionally now and then: definitions that
+# pile up in branches with no kill in between all reach the next use, and
+# reaching definitions is quadratic in those.
+# Usage: benchmarks/analysis.sh [path/to/mini_compiler] [statements ...]
+compiler=${1:-./mini_compiler}
+[ $# -gt 0 ] && shift
+sizes=${*:-1500 15000 150000}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+for statements in $sizes; do
+    program="$dir/p$statements.custom"
+    awk -v statements="$statements" 'BEGIN {
+        srand(1)
+        print "integer i === 0;"
+        print "integer n === 0;"
+        print "decimal d === 0.5;"
+        for (s = 0; s < statements; s++) {
+            k = int(rand() * 4)
+            if (k == 0) printf "integer v%d === i * %d + n;\nn === v%d;\n", s, int(rand() * 9) + 1, s
+            else if (k == 1) printf "d === d * 1.5 + %d.25;\n", s % 7
+            else if (k == 2) printf "integer c%d === i;\nwhile \"c%d < %d\" {\n    c%d === c%d + 1;\n    n === n + c%d;\n}\n", s, s, s, s, s, s
+            else printf "if \"d > %d.5 && i != %d\" {\n    n === n - 1;\n} else {\n    print i;\n}\n", s, s
+        }
+        print "print n;"
+    }' > "$program"
+    "$compiler" -O0 --bench-analysis "$program" | grep '^analysis:'
+    start=$(date +%s%N)
+    "$compiler" -O2 -o "$dir/out.tac" "$program" > /dev/null
+    echo "-O2 compile: $(( ($(date +%s%N) - start) / 1000000 )) ms"
+done
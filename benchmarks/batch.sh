@@ -0,0 +1,26 @@
+#!/bin/sh
+# Generates a corpus of programs and times batch compilation of it on 1, 2,
+# 4, ... threads up to the core count.
+# Usage: benchmarks/batch.sh [path/to/mini_compiler] [files] [statements per file]
+compiler=${1:-./mini_compiler}
+files=${2:-2000}
+statements=${3:-400}
+corpus=$(mktemp -d)
+trap 'rm -rf "$corpus"' EXIT
+awk -v files="$files" -v statements="$statements" -v dir="$corpus" 'BEGIN {
+    srand(1)
+    for (f = 0; f < files; f++) {
+        out = sprintf("%s/p%05d.custom", dir, f)
+        print "integer i === 0;" > out
+        print "decimal d === 0.5;" > out
+        for (s = 0; s < statements; s++) {
+            k = int(rand() * 4)
+            if (k == 0) printf "integer v%d === i * %d + %d;\n", s, int(rand() * 9) + 1, s > out
+            else if (k == 1) printf "d === d * 1.5 + %d.25;\n", s % 7 > out
+            else if (k == 2) printf "while \"i < %d\" {\n    i === i + 1;\n    d === d + i;\n}\n", s > out
+            else printf "if \"d > %d.5 && i != %d\" {\n    print d;\n} else {\n    print i;\n}\n", s, s > out
+        }
+        close(out)
+    }
+}'
+"$compiler" -O2 --emit=obj -o "$corpus" --bench-batch "$corpus"
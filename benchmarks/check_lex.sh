@@ -0,0 +1,22 @@
+#!/bin/sh
+# Differential test of the parallel lexer: runs --check-lex on every
+# program here at several chunk sizes and thread counts, and fails if any
+# run's tokens differ from the sequential lexer's.
+# Usage: benchmarks/check_lex.sh [path/to/mini_compiler]
+compiler=${1:-./mini_compiler}
+dir=$(dirname "$0")
+runs=0
+failed=0
+for program in "$dir"/*.custom; do
+    for chunk in 1 16 64 256 4096 0; do
+        for threads in 1 2 4 8; do
+            runs=$((runs + 1))
+            if ! "$compiler" --check-lex="$chunk" -j "$threads" "$program" > /dev/null; then
+                echo "mismatch: $(basename "$program") chunk $chunk, $threads threads"
+                failed=$((failed + 1))
+            fi
+        done
+    done
+done
+echo "check-lex: $runs runs, $failed mismatches"
+[ "$failed" -eq 0 ]
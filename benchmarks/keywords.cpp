@@ -0,0 +1,207 @@
+// keywords.cpp
+// Times the table-driven Lexer against the dispatch it replaced: chained
+// isspace/isalnum/isdigit tests per character and a string compare per
+// keyword. The baseline keeps that dispatch but produces today's tokens
+// (the later operators, parentheses and comments included) and interns
+// what the Lexer interns, so the two differ only in dispatch and keyword
+// lookup; they must agree token for token. Built and run by
+// benchmarks/keywords.sh.
+#include "interner.h"
+#include "lexer.h"
+#include "source_buffer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+bool isOperatorChar(char c) {
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '<' || c == '>' || c == '!' || c == '&' || c == '|';
+}
+
+// The lexer's dispatch before the character-class and keyword tables
+class BaselineLexer {
+    std::string_view source;
+    Interner& interner;
+    size_t pos = 0;
+    char currentChar;
+
+    void advance() {
+        pos++;
+        currentChar = pos < source.size() ? source[pos] : '\0';
+    }
+
+    void seek(size_t newPos) {
+        pos = std::min(newPos, source.size());
+        currentChar = pos < source.size() ? source[pos] : '\0';
+    }
+
+    void skipWhitespace() {
+        while (isspace(currentChar)) advance();
+    }
+
+    void skipComment() {
+        if (source[pos + 1] == '/') {
+            size_t end = source.find('\n', pos);
+            seek(end == std::string_view::npos ? source.size() : end);
+        } else {
+            size_t end = source.find("*/", pos + 2);
+            seek(end == std::string_view::npos ? source.size() : end + 2);
+        }
+    }
+
+    Token number() {
+        size_t start = pos;
+        bool hasDot = false;
+        while (isdigit(currentChar) || currentChar == '.') {
+            if (currentChar == '.') {
+                if (hasDot) break; // only one dot allowed
+                hasDot = true;
+            }
+            advance();
+        }
+        std::string_view result = source.substr(start, pos - start);
+        return Token(TokenType::NUMBER, result, interner.intern(result));
+    }
+
+    Token identifierOrKeyword() {
+        size_t start = pos;
+        while (isalnum(currentChar) || currentChar == '_') advance();
+        std::string_view result = source.substr(start, pos - start);
+
+        // Check keywords
+        if (result == "integer") return Token(TokenType::INTEGER_TYPE, result);
+        if (result == "decimal") return Token(TokenType::DECIMAL_TYPE, result);
+        if (result == "string") return Token(TokenType::STRING_TYPE, result);
+        if (result == "if") return Token(TokenType::IF, result);
+        if (result == "else") return Token(TokenType::ELSE, result);
+        if (result == "while") return Token(TokenType::WHILE, result);
+        if (result == "for") return Token(TokenType::FOR, result);
+        if (result == "print") return Token(TokenType::PRINT, result);
+
+        return Token(TokenType::IDENTIFIER, result, interner.intern(result));
+    }
+
+    Token stringLiteral() {
+        advance(); // skip opening quote
+        size_t start = pos;
+        while (currentChar != '"' && currentChar != '\0') advance();
+        std::string_view result = source.substr(start, pos - start);
+        if (currentChar == '"') advance(); // skip closing quote
+        return Token(TokenType::STRING_LITERAL, result, interner.intern(result));
+    }
+
+    Token single(TokenType type) {
+        advance();
+        return Token(type, source.substr(pos - 1, 1));
+    }
+
+public:
+    BaselineLexer(std::string_view src, Interner& interner) : source(src), interner(interner) {
+        currentChar = pos < source.size() ? source[pos] : '\0';
+    }
+
+    Token getNextToken() {
+        while (currentChar != '\0') {
+            if (isspace(currentChar)) {
+                skipWhitespace();
+                continue;
+            }
+            if (currentChar == '=') {
+                size_t start = pos;
+                if (pos + 2 < source.size() && source[pos + 1] == '=' && source[pos + 2] == '=') {
+                    seek(pos + 3);
+                    return Token(TokenType::ASSIGN, source.substr(start, 3));
+                }
+                if (pos + 1 < source.size() && source[pos + 1] == '=') {
+                    seek(pos + 2);
+                    return Token(TokenType::OPERATOR, source.substr(start, 2));
+                }
+                return single(TokenType::UNKNOWN);
+            }
+            if (currentChar == ';') return single(TokenType::SEMICOLON);
+            if (currentChar == ',') return single(TokenType::COMMA);
+            if (currentChar == '{') return single(TokenType::LBRACE);
+            if (currentChar == '}') return single(TokenType::RBRACE);
+            if (currentChar == '(') return single(TokenType::LPAREN);
+            if (currentChar == ')') return single(TokenType::RPAREN);
+            if (currentChar == '"') return stringLiteral();
+            if (isdigit(currentChar)) return number();
+            if (isalpha(currentChar) || currentChar == '_') return identifierOrKeyword();
+            if (isOperatorChar(currentChar)) {
+                if (currentChar == '/' && pos + 1 < source.size() && (source[pos + 1] == '/' || source[pos + 1] == '*')) {
+                    skipComment();
+                    continue;
+                }
+                size_t start = pos;
+                char first = currentChar;
+                advance();
+                if ((first == '<' || first == '>' || first == '!') && currentChar == '=') {
+                    advance();
+                } else if ((first == '&' || first == '|' || first == '+' || first == '-') && currentChar == first) {
+                    advance();
+                }
+                return Token(TokenType::OPERATOR, source.substr(start, pos - start));
+            }
+            return single(TokenType::UNKNOWN);
+        }
+        return Token(TokenType::END_OF_FILE, source.substr(pos, 0));
+    }
+};
+
+template <typename AnyLexer>
+std::vector<Token> lexAll(std::string_view source, Interner& interner) {
+    AnyLexer lexer(source, interner);
+    std::vector<Token> tokens;
+    for (Token t; (t = lexer.getNextToken()).type != TokenType::END_OF_FILE;) tokens.push_back(t);
+    return tokens;
+}
+
+// Best of rounds, in milliseconds
+template <typename AnyLexer>
+double best(std::string_view source, int rounds, std::vector<Token>& tokens) {
+    double fastest = 0;
+    for (int r = 0; r < rounds; r++) {
+        Interner interner;
+        auto begin = std::chrono::steady_clock::now();
+        tokens = lexAll<AnyLexer>(source, interner);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if (r == 0 || ms < fastest) fastest = ms;
+    }
+    return fastest;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: keywords SOURCE [rounds]\n");
+        return 2;
+    }
+    SourceBuffer source;
+    if (!source.open(argv[1])) {
+        std::fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 2;
+    }
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::vector<Token> before, after;
+    double baseline = best<BaselineLexer>(source.view(), rounds, before);
+    double tables = best<Lexer>(source.view(), rounds, after);
+    bool same = before.size() == after.size() &&
+                std::equal(before.begin(), before.end(), after.begin(), [](const Token& a, const Token& b) {
+                    return a.type == b.type && a.lexeme.data() == b.lexeme.data() && a.lexeme.size() == b.lexeme.size();
+                });
+    if (!same) {
+        std::fprintf(stderr, "keywords: the lexers disagree\n");
+        return 1;
+    }
+    std::printf("keywords: %zu tokens, best of %d\n", after.size(), rounds);
+    std::printf("  isalnum + string compares  %8.3f ms  %5.1f ns/token\n", baseline, baseline * 1e6 / double(after.size()));
+    std::printf("  class + keyword tables     %8.3f ms  %5.1f ns/token (%.2fx)\n", tables,
+                tables * 1e6 / double(after.size()), baseline / std::max(tables, 1e-3));
+    return 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Times the lexer on keyword-dense input: keywords.custom repeated until
+# the source has about the given number of tokens. keywords.cpp lexes it
+# with the character-class and keyword tables and with the chained
+# isalnum tests and keyword string compares they replaced.
+# Usage: benchmarks/keywords.sh [tokens] [rounds]
+tokens=${1:-3000000}
+rounds=${2:-5}
+dir=$(dirname "$0")
+binary=$(mktemp)
+source=$(mktemp)
+trap 'rm -f "$binary" "$source"' EXIT
+${CXX:-g++} -std=c++17 -O2 -I"$dir/.." "$dir/keywords.cpp" "$dir/../lexer.cpp" "$dir/../interner.cpp" \
+    "$dir/../simd_scan.cpp" "$dir/../source_buffer.cpp" -o "$binary" || exit 1
+per=$("$binary" "$dir/keywords.custom" 1 | awk 'NR == 1 { print $2 }')
+awk -v copies=$(( (tokens + per - 1) / per )) '{ line[NR] = $0 } END {
+    for (c = 0; c < copies; c++) for (i = 1; i <= NR; i++) print line[i]
+}' "$dir/keywords.custom" > "$source"
+"$binary" "$source" "$rounds"
@@ -0,0 +1,9 @@
+#!/bin/sh
+# Times the bytecode VM's threaded dispatch against the switch loop on
+# each program here. Usage: benchmarks/run.sh [path/to/mini_compiler]
+compiler=${1:-./mini_compiler}
+dir=$(dirname "$0")
+for program in "$dir"/*.custom; do
+    printf '%-24s ' "$(basename "$program")"
+    "$compiler" -O2 --bench-vm "$program" | grep '^vm:'
+done
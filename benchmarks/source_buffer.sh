@@ -0,0 +1,21 @@
+#!/bin/sh
+# Generates a large source and times reading and lexing it into a token
+# list two ways (--bench-lex): through ifstream into a string with every
+# lexeme copied out, the path before sources were memory-mapped, and
+# mapped with lexemes that point into the mapping.
+# Usage: benchmarks/source_buffer.sh [path/to/mini_compiler] [megabytes]
+compiler=${1:-./mini_compiler}
+megabytes=${2:-32}
+source=$(mktemp)
+trap 'rm -f "$source"' EXIT
+awk -v bytes=$((megabytes * 1048576)) 'BEGIN {
+    srand(1)
+    while (written < bytes) {
+        s = sprintf("integer total%d === total%d + %d * count;\nif \"total%d > limit\" {\n    print \"over the limit\";\n}\n",
+                    n, n, int(rand() * 1000), n)
+        printf "%s", s
+        written += length(s)
+        n++
+    }
+}' > "$source"
+"$compiler" --bench-lex "$source"
@@ -0,0 +1,116 @@
+// symbol_table.cpp
+// Times SymbolTable against the unordered_map tables it replaced: the
+// original name -> type-name map of strings, and the SymbolId -> Type map
+// that followed interning. Each round declares every name once, checking
+// for a redeclaration first as the parser does, then looks every name up
+// a number of times. Built and run by benchmarks/symbol_table.sh.
+#include "interner.h"
+#include "symbol_table.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The baseline table
+class StringTable {
+    std::unordered_map<std::string, std::string> table; // varName -> type
+
+public:
+    void insert(const std::string& name, const std::string& type) { table[name] = type; }
+    bool exists(const std::string& name) const { return table.find(name) != table.end(); }
+    std::string getType(const std::string& name) const {
+        auto it = table.find(name);
+        return it != table.end() ? it->second : "";
+    }
+};
+
+// The table after interning, before scopes
+class IdTable {
+    std::unordered_map<SymbolId, Type> table; // varName -> type
+
+public:
+    void insert(SymbolId name, Type type) { table[name] = type; }
+    bool exists(SymbolId name) const { return table.find(name) != table.end(); }
+    Type getType(SymbolId name) const {
+        auto it = table.find(name);
+        return it != table.end() ? it->second : Type::None;
+    }
+};
+
+const Type TYPES[] = {Type::Integer, Type::Decimal, Type::String};
+
+// Best of rounds runs of round, in milliseconds
+template <typename Round>
+double best(int rounds, Round round, size_t& check) {
+    double fastest = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto begin = std::chrono::steady_clock::now();
+        check += round();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if (r == 0 || ms < fastest) fastest = ms;
+    }
+    return fastest;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t names = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    int passes = argc > 2 ? std::atoi(argv[2]) : 10;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    std::vector<std::string> spellings;
+    std::vector<SymbolId> ids;
+    Interner interner;
+    for (size_t i = 0; i < names; i++) {
+        spellings.push_back("value" + std::to_string(i));
+        ids.push_back(interner.intern(spellings.back()));
+    }
+
+    size_t check = 0;
+    double strings = best(rounds, [&] {
+        StringTable table;
+        size_t found = 0;
+        for (size_t i = 0; i < names; i++) {
+            if (!table.exists(spellings[i])) table.insert(spellings[i], typeName(TYPES[i % 3]));
+        }
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < names; i++) found += table.getType(spellings[i]).size();
+        }
+        return found;
+    }, check);
+    double interned = best(rounds, [&] {
+        IdTable table;
+        size_t found = 0;
+        for (size_t i = 0; i < names; i++) {
+            if (!table.exists(ids[i])) table.insert(ids[i], TYPES[i % 3]);
+        }
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < names; i++) found += size_t(table.getType(ids[i]));
+        }
+        return found;
+    }, check);
+    double scoped = best(rounds, [&] {
+        SymbolTable table;
+        size_t found = 0;
+        for (size_t i = 0; i < names; i++) {
+            if (!table.declaredInCurrentScope(ids[i])) table.insert(ids[i], TYPES[i % 3], VarId(i));
+        }
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < names; i++) found += size_t(table.lookup(ids[i])->type);
+        }
+        return found;
+    }, check);
+
+    std::printf("symbols: %zu names, %d lookup passes, best of %d\n", names, passes, rounds);
+    std::printf("  unordered_map<string, string>  %8.3f ms\n", strings);
+    std::printf("  unordered_map<SymbolId, Type>  %8.3f ms\n", interned);
+    std::printf("  SymbolTable                    %8.3f ms (%.2fx, %.2fx)\n", scoped, strings / std::max(scoped, 1e-3),
+                interned / std::max(scoped, 1e-3));
+    return check == 0; // keeps the work observable
+}
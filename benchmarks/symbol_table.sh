@@ -0,0 +1,10 @@
+#!/bin/sh
+# Builds symbol_table.cpp against the tree's SymbolTable and interner and
+# compares it with the unordered_map tables it replaced.
+# Usage: benchmarks/symbol_table.sh [names] [lookup passes] [rounds]
+dir=$(dirname "$0")
+binary=$(mktemp)
+trap 'rm -f "$binary"' EXIT
+${CXX:-g++} -std=c++17 -O2 -I"$dir/.." "$dir/symbol_table.cpp" "$dir/../symbol_table.cpp" "$dir/../interner.cpp" \
+    -o "$binary" || exit 1
+"$binary" "$@"
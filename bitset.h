@@ -0,0 +1,18 @@
+// bitset.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size dense bitset, used for per-block marks in the dataflow code
+class DenseBitset {
+    std::vector<uint64_t> words;
+
+public:
+    DenseBitset() = default;
+    explicit DenseBitset(size_t bits) : words((bits + 63) / 64, 0) {}
+
+    void set(size_t i) { words[i >> 6] |= uint64_t(1) << (i & 63); }
+    void reset(size_t i) { words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+};
@@ -0,0 +1,198 @@
+// bytecode.cpp
+#include "bytecode.h"
+#include <cassert>
+#include <charconv>
+#include <cstdlib>
+
+namespace {
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+// a cc b fails exactly when a negate(cc) b holds, for integers
+Opcode negate(Opcode op) {
+    switch (op) {
+    case Opcode::Lt: return Opcode::Ge;
+    case Opcode::Gt: return Opcode::Le;
+    case Opcode::Le: return Opcode::Gt;
+    case Opcode::Ge: return Opcode::Lt;
+    case Opcode::Eq: return Opcode::Ne;
+    default: return Opcode::Eq;
+    }
+}
+
+// Offset of a comparison or arithmetic opcode within its group
+uint32_t groupIndex(Opcode op) {
+    switch (op) {
+    case Opcode::Add: case Opcode::Lt: return 0;
+    case Opcode::Sub: case Opcode::Gt: return 1;
+    case Opcode::Mul: case Opcode::Le: return 2;
+    case Opcode::Div: case Opcode::Ge: return 3;
+    case Opcode::Eq: return 4;
+    default: return 5;
+    }
+}
+
+BcOp offset(BcOp first, Opcode op) {
+    return BcOp(uint32_t(first) + groupIndex(op));
+}
+
+class BytecodeLowering {
+    const TacCode& code;
+    const Interner& interner;
+    Bytecode out;
+    uint32_t scratch;                    // two registers for conversions
+    std::vector<uint32_t> decimalConstant; // integer constant -> its decimal copy in the pool
+    std::vector<uint32_t> tempUses;
+    std::vector<uint32_t> labelTarget;
+    std::vector<size_t> jumps;           // instructions whose c is still a label
+
+    uint32_t reg(Operand o) const {
+        switch (o.kind()) {
+        case OperandKind::Var: return o.index();
+        case OperandKind::Temp: return uint32_t(code.vars.size()) + o.index();
+        default: return out.constantBase + o.index();
+        }
+    }
+
+    bool decimal(Operand o) const { return code.typeOf(o) == Type::Decimal; }
+
+    void emit(BcOp op, uint32_t a, uint32_t b = 0, uint32_t c = 0) { out.insts.push_back(BcInst{op, a, b, c}); }
+
+    void jump(BcOp op, uint32_t a, uint32_t b, Operand label) {
+        jumps.push_back(out.insts.size());
+        emit(op, a, b, label.index());
+    }
+
+    // Register holding o's value as a decimal; k picks the scratch register
+    uint32_t asDecimal(Operand o, uint32_t k) {
+        if (decimal(o)) return reg(o);
+        if (o.kind() == OperandKind::Const) {
+            uint32_t& copy = decimalConstant[o.index()];
+            if (copy == NONE) {
+                VmValue v;
+                v.d = double(out.constants[o.index()].i);
+                copy = out.constantBase + uint32_t(out.constants.size());
+                out.constants.push_back(v);
+            }
+            return copy;
+        }
+        emit(BcOp::IntToDec, scratch + k, reg(o));
+        return scratch + k;
+    }
+
+    // dst = op(b, c), converting when the result type is not dst's
+    void result(Operand dst, bool decimalResult, BcOp op, uint32_t b, uint32_t c) {
+        if (decimal(dst) == decimalResult) {
+            emit(op, reg(dst), b, c);
+            return;
+        }
+        emit(op, scratch, b, c);
+        emit(decimalResult ? BcOp::DecToInt : BcOp::IntToDec, reg(dst), scratch);
+    }
+
+    // A comparison whose only reader is the branch right after it
+    bool fusable(size_t i) const {
+        Operand t = code.dst[i];
+        if (i + 1 >= code.size() || t.kind() != OperandKind::Temp || tempUses[t.index()] != 1) return false;
+        Opcode next = code.ops[i + 1];
+        return (next == Opcode::IfFalse || next == Opcode::IfTrue) && code.lhs[i + 1] == t;
+    }
+
+    void constants() {
+        out.constants.resize(code.consts.size());
+        for (size_t k = 0; k < code.consts.size(); k++) {
+            const Constant& c = code.consts[k];
+            std::string_view text = interner.name(c.text);
+            VmValue& v = out.constants[k];
+            if (c.type == Type::String) {
+                out.strings.emplace_back(text);
+                v.s = out.strings.back().c_str();
+            } else if (c.type == Type::Decimal) {
+                v.d = std::strtod(std::string(text).c_str(), nullptr);
+            } else {
+                v.i = 0;
+                [[maybe_unused]] auto parsed = std::from_chars(text.data(), text.data() + text.size(), v.i);
+                assert(parsed.ec == std::errc()); // the parser rejects out-of-range literals
+            }
+        }
+    }
+
+    void instruction(size_t& i) {
+        Opcode op = code.ops[i];
+        Operand dst = code.dst[i], lhs = code.lhs[i], rhs = code.rhs[i];
+        switch (op) {
+        case Opcode::Label:
+            labelTarget[dst.index()] = uint32_t(out.insts.size());
+            break;
+        case Opcode::Goto:
+            jump(BcOp::Jmp, 0, 0, dst);
+            break;
+        case Opcode::IfFalse:
+            jump(decimal(lhs) ? BcOp::JzD : BcOp::JzI, reg(lhs), 0, dst);
+            break;
+        case Opcode::IfTrue:
+            jump(decimal(lhs) ? BcOp::JnzD : BcOp::JnzI, reg(lhs), 0, dst);
+            break;
+        case Opcode::Print: {
+            Type type = code.typeOf(lhs);
+            emit(type == Type::String ? BcOp::PrintS : type == Type::Decimal ? BcOp::PrintD : BcOp::PrintI, reg(lhs));
+            break;
+        }
+        case Opcode::Assign:
+            if (decimal(dst) && !decimal(lhs)) emit(BcOp::Mov, reg(dst), asDecimal(lhs, 0));
+            else if (!decimal(dst) && decimal(lhs)) emit(BcOp::DecToInt, reg(dst), reg(lhs));
+            else emit(BcOp::Mov, reg(dst), reg(lhs));
+            break;
+        default: {
+            bool decimals = decimal(lhs) || decimal(rhs);
+            if (isComparison(op)) {
+                if (code.typeOf(lhs) == Type::String) {
+                    result(dst, false, op == Opcode::Eq ? BcOp::EqS : BcOp::NeS, reg(lhs), reg(rhs));
+                } else if (decimals) {
+                    result(dst, false, offset(BcOp::LtD, op), asDecimal(lhs, 0), asDecimal(rhs, 1));
+                } else if (fusable(i)) {
+                    i++;
+                    Opcode taken = code.ops[i] == Opcode::IfFalse ? negate(op) : op;
+                    jump(offset(BcOp::JLtI, taken), reg(lhs), reg(rhs), code.dst[i]);
+                } else {
+                    result(dst, false, offset(BcOp::LtI, op), reg(lhs), reg(rhs));
+                }
+            } else if (decimals) {
+                result(dst, true, offset(BcOp::AddD, op), asDecimal(lhs, 0), asDecimal(rhs, 1));
+            } else {
+                result(dst, false, offset(BcOp::AddI, op), reg(lhs), reg(rhs));
+            }
+            break;
+        }
+        }
+    }
+
+public:
+    BytecodeLowering(const TacCode& code, const Interner& interner)
+        : code(code), interner(interner), decimalConstant(code.consts.size(), NONE),
+          tempUses(code.tempTypes.size(), 0), labelTarget(code.labelCount, 0) {
+        scratch = uint32_t(code.vars.size() + code.tempTypes.size());
+        out.constantBase = scratch + 2;
+    }
+
+    Bytecode run() {
+        constants();
+        for (size_t i = 0; i < code.size(); i++) {
+            for (Operand o : {code.lhs[i], code.rhs[i]}) {
+                if (o.kind() == OperandKind::Temp) tempUses[o.index()]++;
+            }
+        }
+        out.insts.reserve(code.size() + 1);
+        for (size_t i = 0; i < code.size(); i++) instruction(i);
+        emit(BcOp::Halt, 0);
+        for (size_t j : jumps) out.insts[j].c = labelTarget[out.insts[j].c];
+        out.registers = out.constantBase + uint32_t(out.constants.size());
+        return std::move(out);
+    }
+};
+
+} // namespace
+
+Bytecode lowerToBytecode(const TacCode& code, const Interner& interner) {
+    return BytecodeLowering(code, interner).run();
+}
@@ -0,0 +1,55 @@
+// bytecode.h
+#pragma once
+#include "interner.h"
+#include "tac.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Register bytecode opcodes. Arithmetic and comparisons are specialized
+// by operand type when lowering (I integer, D decimal, S string); the
+// J<cc>I forms fuse an integer comparison with the branch reading it.
+#define BYTECODE_OPS(X) \
+    X(Mov) X(IntToDec) X(DecToInt) \
+    X(AddI) X(SubI) X(MulI) X(DivI) \
+    X(AddD) X(SubD) X(MulD) X(DivD) \
+    X(LtI) X(GtI) X(LeI) X(GeI) X(EqI) X(NeI) \
+    X(LtD) X(GtD) X(LeD) X(GeD) X(EqD) X(NeD) \
+    X(EqS) X(NeS) \
+    X(Jmp) X(JzI) X(JnzI) X(JzD) X(JnzD) \
+    X(JLtI) X(JGtI) X(JLeI) X(JGeI) X(JEqI) X(JNeI) \
+    X(PrintI) X(PrintD) X(PrintS) \
+    X(Halt)
+
+enum class BcOp : uint32_t {
+#define BYTECODE_ENUM(name) name,
+    BYTECODE_OPS(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+// Fixed-width instruction: a = dst or tested register, b and c sources;
+// jumps keep their target instruction index in c
+struct BcInst {
+    BcOp op;
+    uint32_t a, b, c;
+};
+
+union VmValue {
+    int64_t i;
+    double d;
+    const char* s;
+};
+
+// Registers hold variables, then temps, then the constant pool, which is
+// copied in before running; a couple of scratch registers follow for
+// mixed-type conversions
+struct Bytecode {
+    std::vector<BcInst> insts;
+    std::vector<VmValue> constants;
+    uint32_t constantBase = 0;
+    uint32_t registers = 0;
+    std::deque<std::string> strings; // storage behind string constants
+};
+
+Bytecode lowerToBytecode(const TacCode& code, const Interner& interner);
@@ -0,0 +1,143 @@
+// cfg.cpp
+#include "cfg.h"
+
+namespace {
+
+bool isJump(Opcode op) {
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::IfTrue;
+}
+
+} // namespace
+
+Cfg::Cfg(const TacCode& code) : labelBlock(code.labelCount, NONE) {
+    uint32_t n = static_cast<uint32_t>(code.size());
+    blocks.push_back(BasicBlock{0, 0, {}, {}}); // entry
+
+    // Leaders: the first instruction, every label, and whatever follows a jump
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        Opcode op = code.ops[i];
+        if (op == Opcode::Label && i != start) {
+            blocks.push_back(BasicBlock{start, i, {}, {}});
+            start = i;
+        }
+        if (op == Opcode::Label) labelBlock[code.dst[i].index()] = static_cast<uint32_t>(blocks.size());
+        if (isJump(op)) {
+            blocks.push_back(BasicBlock{start, i + 1, {}, {}});
+            start = i + 1;
+        }
+    }
+    if (start < n) blocks.push_back(BasicBlock{start, n, {}, {}});
+
+    uint32_t count = static_cast<uint32_t>(blocks.size());
+    for (uint32_t b = 0; b < count; b++) {
+        BasicBlock& block = blocks[b];
+        Opcode last = block.end > block.begin ? code.ops[block.end - 1] : Opcode::Label;
+        uint32_t target = isJump(last) ? labelBlock[code.dst[block.end - 1].index()] : NONE;
+        if (target != NONE) block.succs.push_back(target);
+        // A conditional jump to the next block is one edge, not two
+        if (last != Opcode::Goto && b + 1 < count && target != b + 1) block.succs.push_back(b + 1);
+        for (uint32_t succ : block.succs) blocks[succ].preds.push_back(b);
+    }
+
+    computeOrder();
+}
+
+void Cfg::computeOrder() {
+    uint32_t count = static_cast<uint32_t>(blocks.size());
+    rpoIndex.assign(count, NONE);
+    rpo.clear();
+
+    // Iterative DFS postorder from the entry
+    std::vector<uint8_t> visited(count, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+    visited[0] = 1;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < blocks[block].succs.size()) {
+            uint32_t succ = blocks[block].succs[next++];
+            if (!visited[succ]) {
+                visited[succ] = 1;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            rpo.push_back(block);
+            stack.pop_back();
+        }
+    }
+    for (size_t i = 0, j = rpo.size() - 1; i < j; i++, j--) std::swap(rpo[i], rpo[j]);
+    for (uint32_t i = 0; i < rpo.size(); i++) rpoIndex[rpo[i]] = i;
+}
+
+void Cfg::computeDominators() {
+    uint32_t count = static_cast<uint32_t>(blocks.size());
+    idom.assign(count, NONE);
+    idom[0] = 0;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (rpoIndex[a] > rpoIndex[b]) a = idom[a];
+            while (rpoIndex[b] > rpoIndex[a]) b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            uint32_t b = rpo[i];
+            uint32_t newIdom = NONE;
+            for (uint32_t p : blocks[b].preds) {
+                if (idom[p] == NONE) continue; // unprocessed or unreachable
+                newIdom = newIdom == NONE ? p : intersect(p, newIdom);
+            }
+            if (newIdom != idom[b]) {
+                idom[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    domChildren.assign(count, {});
+    for (uint32_t b : rpo) {
+        if (b != 0) domChildren[idom[b]].push_back(b);
+    }
+
+    // Pre-order numbering of the dominator tree gives O(1) dominance queries
+    preorder.assign(count, NONE);
+    lastDescendant.assign(count, NONE);
+    uint32_t clock = 0;
+    std::vector<std::pair<uint32_t, size_t>> stack{{0, 0}};
+    preorder[0] = clock++;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < domChildren[block].size()) {
+            uint32_t child = domChildren[block][next++];
+            preorder[child] = clock++;
+            stack.push_back({child, 0});
+        } else {
+            lastDescendant[block] = clock - 1;
+            stack.pop_back();
+        }
+    }
+}
+
+bool Cfg::dominates(uint32_t a, uint32_t b) const {
+    if (preorder[a] == NONE || preorder[b] == NONE) return false;
+    return preorder[a] <= preorder[b] && preorder[b] <= lastDescendant[a];
+}
+
+void Cfg::computeFrontiers() {
+    frontier.assign(blocks.size(), {});
+    for (uint32_t b : rpo) {
+        if (blocks[b].preds.size() < 2) continue;
+        for (uint32_t p : blocks[b].preds) {
+            if (!reachable(p)) continue;
+            for (uint32_t runner = p; runner != idom[b]; runner = idom[runner]) {
+                auto& df = frontier[runner];
+                if (df.empty() || df.back() != b) df.push_back(b);
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+// cfg.h
+#pragma once
+#include "tac.h"
+#include <cstdint>
+#include <vector>
+
+struct BasicBlock {
+    uint32_t begin, end; // instruction range [begin, end)
+    std::vector<uint32_t> preds, succs;
+};
+
+// Control-flow graph over a TacCode. Block 0 is an empty entry block that
+// falls into the first instruction, so the real first block can take back
+// edges like any other. The dominator tree is computed with the
+// Cooper-Harvey-Kennedy iterative algorithm over reverse postorder.
+class Cfg {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<BasicBlock> blocks;
+    std::vector<uint32_t> labelBlock;  // label index -> block starting with it
+    std::vector<uint32_t> rpo;         // reachable blocks in reverse postorder
+    std::vector<uint32_t> rpoIndex;    // block -> position in rpo, NONE if unreachable
+    std::vector<uint32_t> idom;        // immediate dominator, NONE if unreachable
+    std::vector<std::vector<uint32_t>> domChildren;
+    std::vector<std::vector<uint32_t>> frontier;
+
+    explicit Cfg(const TacCode& code);
+
+    bool reachable(uint32_t block) const { return rpoIndex[block] != NONE; }
+    bool dominates(uint32_t a, uint32_t b) const; // a dominates b
+
+    void computeDominators();
+    void computeFrontiers(); // requires dominators
+
+private:
+    std::vector<uint32_t> preorder, lastDescendant; // dominator tree numbering
+
+    void computeOrder();
+};
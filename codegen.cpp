@@ -0,0 +1,435 @@
+// codegen.cpp
+#include "codegen.h"
+#include "dataflow.h"
+#include <cassert>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+Cond conditionOf(Opcode op) {
+    switch (op) {
+    case Opcode::Lt: return Cond::l;
+    case Opcode::Gt: return Cond::g;
+    case Opcode::Le: return Cond::le;
+    case Opcode::Ge: return Cond::ge;
+    case Opcode::Eq: return Cond::e;
+    default: return Cond::ne;
+    }
+}
+
+constexpr MOp DECIMAL_OPS[] = {MOp::Addsd, MOp::Subsd, MOp::Mulsd, MOp::Divsd}; // by Opcode from Add
+
+class CodeGenerator {
+    const TacCode& code;
+    const Interner& interner;
+    const Allocation& allocation;
+    MachineCode out;
+    CodegenStats stats;
+    std::vector<uint32_t> constSymbol; // string constant -> symbol, NONE until used
+    std::unordered_map<uint64_t, uint32_t> decimalPool; // bit pattern -> 8-byte rodata symbol
+    uint32_t frameSlots;               // callee-saved saves, then spill slots
+    uint32_t nextLabel;                // labels past the TAC's own
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static MOperand scratch() { return MOperand::r(SCRATCH); }
+    bool decimal(Operand o) const { return code.typeOf(o) == Type::Decimal; }
+
+    uint32_t symbol(const std::string& name, std::string bytes, bool external) {
+        out.symbols.push_back(MachineCode::Symbol{name, std::move(bytes), external, true});
+        return static_cast<uint32_t>(out.symbols.size() - 1);
+    }
+
+    uint32_t helper(const char* name) {
+        for (uint32_t k = 0; k < out.symbols.size(); k++) {
+            if (out.symbols[k].name == name) return k;
+        }
+        return symbol(name, "", true);
+    }
+
+    // The value of a numeric constant as a pooled double in rodata
+    MOperand decimalConstant(Operand operand) {
+        const Constant& c = code.consts[operand.index()];
+        std::string_view text = interner.name(c.text);
+        double d;
+        if (c.type == Type::Decimal) {
+            d = std::strtod(std::string(text).c_str(), nullptr);
+        } else {
+            int64_t value = 0;
+            [[maybe_unused]] auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+            assert(parsed.ec == std::errc()); // the parser rejects out-of-range literals
+            d = double(value);
+        }
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        auto [it, added] = decimalPool.try_emplace(bits, uint32_t(out.symbols.size()));
+        if (added) {
+            std::string bytes(8, '\0');
+            std::memcpy(bytes.data(), &bits, sizeof(bits));
+            symbol(".Ldec" + std::to_string(decimalPool.size() - 1), std::move(bytes), false);
+            out.symbols.back().align = 8;
+        }
+        return MOperand::symbol(it->second);
+    }
+
+    MOperand spillSlot(uint32_t slot) const {
+        return MOperand::stack(8 * int64_t(allocation.calleeSaved.size() + slot + 1));
+    }
+
+    // Where a TAC operand lives; string constants are rip-relative symbols
+    MOperand place(Operand operand) {
+        switch (operand.kind()) {
+        case OperandKind::Temp:
+        case OperandKind::Var: {
+            stats.memoryOperandsBefore++;
+            const Location& location = allocation.locations[slotOf(code, operand)];
+            if (location.kind == Location::Register) return MOperand::r(location.reg);
+            stats.memoryOperandsAfter++;
+            return spillSlot(location.slot);
+        }
+        case OperandKind::Const: {
+            const Constant& c = code.consts[operand.index()];
+            std::string_view text = interner.name(c.text);
+            if (c.type == Type::String) {
+                uint32_t& sym = constSymbol[operand.index()];
+                if (sym == NONE) sym = symbol(".Lstr" + std::to_string(operand.index()), std::string(text) + '\0', false);
+                return MOperand::symbol(sym);
+            }
+            if (c.type == Type::Decimal) return decimalConstant(operand);
+            int64_t value = 0;
+            [[maybe_unused]] auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+            assert(parsed.ec == std::errc()); // the parser rejects out-of-range literals
+            return MOperand::imm(value);
+        }
+        default:
+            return MOperand();
+        }
+    }
+
+    // dst = src for any mix of operand kinds
+    void move(MOperand dst, MOperand src) {
+        if (dst == src) return;
+        if (src.kind == MOperandKind::Symbol) {
+            MOperand reg = dst.isReg() ? dst : scratch();
+            out.add(MOp::Lea, reg, src);
+            if (reg != dst) out.add(MOp::Mov, dst, reg);
+            return;
+        }
+        if (dst.isMem() && (src.isMem() || (src.isImm() && !src.fitsImm32()))) {
+            out.add(MOp::Mov, scratch(), src);
+            out.add(MOp::Mov, dst, scratch());
+            return;
+        }
+        out.add(MOp::Mov, dst, src);
+    }
+
+    // A register or memory operand holding v, using reg if v needs loading
+    MOperand readable(MOperand v, Reg reg) {
+        if (v.isImm() || v.kind == MOperandKind::Symbol) {
+            move(MOperand::r(reg), v);
+            return MOperand::r(reg);
+        }
+        return v;
+    }
+
+    // An operand usable as the source of an ALU instruction
+    MOperand source(MOperand v) {
+        if (v.kind == MOperandKind::Symbol || (v.isImm() && !v.fitsImm32())) {
+            move(MOperand::r(SCRATCH_WIDE), v);
+            return MOperand::r(SCRATCH_WIDE);
+        }
+        return v;
+    }
+
+    void arithmetic(MOp op, MOperand d, MOperand a, MOperand b) {
+        bool commutative = op != MOp::Sub;
+        if (op == MOp::Imul && b.fitsImm32() && d.isReg()) {
+            out.add(MOp::Imul3, d, readable(a, d.reg), b);
+            return;
+        }
+        if (d.isReg() && d != b) {
+            move(d, a);
+            out.add(op, d, source(b));
+        } else if (d.isReg() && commutative) {
+            out.add(op, d, source(a)); // d == b
+        } else {
+            move(scratch(), a);
+            out.add(op, scratch(), source(b));
+            move(d, scratch());
+        }
+    }
+
+    // A zero divisor calls a runtime helper that reports the error and
+    // never returns, instead of letting idiv raise SIGFPE. A divisor of -1
+    // negates with wraparound (see the folding rule in optimizer.cpp), as
+    // idiv would trap on INT64_MIN / -1.
+    void divide(MOperand d, MOperand a, MOperand b) {
+        move(scratch(), a);
+        if (b.isImm() && b.value == 0) {
+            out.add(MOp::Call, MOperand::symbol(helper("__division_by_zero")));
+            return;
+        }
+        if (b.isImm() && b.value == -1) {
+            out.add(MOp::Imul3, scratch(), scratch(), MOperand::imm(-1));
+            move(d, scratch());
+            return;
+        }
+        MOperand divisor = readable(b, SCRATCH_WIDE);
+        uint32_t done = NONE;
+        if (!b.isImm()) {
+            uint32_t nonzero = nextLabel++, other = nextLabel++;
+            done = nextLabel++;
+            out.add(MOp::Cmp, divisor, MOperand::imm(0));
+            out.add(MOp::Jcc, Cond::ne, MOperand::label(nonzero));
+            out.add(MOp::Call, MOperand::symbol(helper("__division_by_zero")));
+            out.add(MOp::Label, MOperand::label(nonzero));
+            out.add(MOp::Cmp, divisor, MOperand::imm(-1));
+            out.add(MOp::Jcc, Cond::ne, MOperand::label(other));
+            out.add(MOp::Imul3, scratch(), scratch(), MOperand::imm(-1));
+            out.add(MOp::Jmp, MOperand::label(done));
+            out.add(MOp::Label, MOperand::label(other));
+        }
+        out.add(MOp::Cqo);
+        out.add(MOp::Idiv, divisor);
+        if (done != NONE) out.add(MOp::Label, MOperand::label(done));
+        move(d, scratch());
+    }
+
+    void compare(Cond cc, MOperand d, MOperand a, MOperand b) {
+        if (a.isImm() || a.kind == MOperandKind::Symbol || (a.isMem() && b.isMem())) {
+            move(scratch(), a);
+            a = scratch();
+        }
+        out.add(MOp::Cmp, a, source(b));
+        out.add(MOp::Setcc, cc, MOperand::r(SCRATCH, 1));
+        out.add(MOp::Movzx, MOperand::r(SCRATCH, 4), MOperand::r(SCRATCH, 1));
+        move(d, scratch());
+    }
+
+    void branch(Cond cc, MOperand cond, uint32_t label) {
+        out.add(MOp::Cmp, readable(cond, SCRATCH), MOperand::imm(0));
+        out.add(MOp::Jcc, cc, MOperand::label(label));
+    }
+
+    void print(Operand value) {
+        Type type = code.typeOf(value);
+        if (type == Type::Decimal) moveDecimal(MOperand::r(Reg::xmm0), place(value));
+        else move(MOperand::r(Reg::rdi), place(value));
+        const char* name = type == Type::String ? "__print_string" : type == Type::Decimal ? "__print_decimal" : "__print_int";
+        out.add(MOp::Call, MOperand::symbol(helper(name)));
+    }
+
+    // A register or memory operand holding o as a double; integers are
+    // converted into reg
+    MOperand decimalSource(Operand o, Reg reg) {
+        if (o.kind() == OperandKind::Const) return decimalConstant(o);
+        MOperand v = place(o);
+        if (decimal(o)) return v;
+        out.add(MOp::Cvtsi2sd, MOperand::r(reg), v);
+        return MOperand::r(reg);
+    }
+
+    // dst = src between SSE registers and memory
+    void moveDecimal(MOperand dst, MOperand src) {
+        if (dst == src) return;
+        if (dst.isMem() && src.isMem()) {
+            out.add(MOp::Movsd, MOperand::r(SCRATCH_DECIMAL), src);
+            src = MOperand::r(SCRATCH_DECIMAL);
+        }
+        out.add(MOp::Movsd, dst, src);
+    }
+
+    // Stores the double in SSE register r to the destination, truncating
+    // it when dst is an integer
+    void storeDecimal(Operand dst, MOperand d, Reg r) {
+        if (decimal(dst)) {
+            moveDecimal(d, MOperand::r(r));
+        } else if (d.isReg()) {
+            out.add(MOp::Cvttsd2si, d, MOperand::r(r));
+        } else {
+            out.add(MOp::Cvttsd2si, scratch(), MOperand::r(r));
+            move(d, scratch());
+        }
+    }
+
+    // Stores the integer in rax to the destination, converting it when dst
+    // is a decimal
+    void storeInteger(Operand dst, MOperand d) {
+        if (!decimal(dst)) {
+            move(d, scratch());
+        } else if (d.isReg()) {
+            out.add(MOp::Cvtsi2sd, d, scratch());
+        } else {
+            out.add(MOp::Cvtsi2sd, MOperand::r(SCRATCH_DECIMAL), scratch());
+            moveDecimal(d, MOperand::r(SCRATCH_DECIMAL));
+        }
+    }
+
+    void assign(Operand dst, Operand src) {
+        MOperand d = place(dst);
+        if (decimal(dst)) {
+            moveDecimal(d, decimalSource(src, d.isReg() ? d.reg : SCRATCH_DECIMAL));
+        } else if (!decimal(src)) {
+            move(d, place(src));
+        } else {
+            MOperand v = place(src);
+            if (v.isReg()) {
+                storeDecimal(dst, d, v.reg);
+            } else {
+                out.add(MOp::Movsd, MOperand::r(SCRATCH_DECIMAL), v);
+                storeDecimal(dst, d, SCRATCH_DECIMAL);
+            }
+        }
+    }
+
+    // Arithmetic with a decimal operand, in dst's register when it has one
+    void decimalArithmetic(MOp op, Operand dst, Operand lhs, Operand rhs) {
+        MOperand d = place(dst);
+        MOperand b = decimalSource(rhs, SCRATCH_CONVERT);
+        Reg r = decimal(dst) && d.isReg() ? d.reg : SCRATCH_DECIMAL;
+        if (b == MOperand::r(r)) { // dst is rhs
+            if (op == MOp::Addsd || op == MOp::Mulsd) {
+                out.add(op, MOperand::r(r), decimalSource(lhs, SCRATCH_CONVERT));
+                storeDecimal(dst, d, r);
+                return;
+            }
+            r = SCRATCH_DECIMAL;
+        }
+        moveDecimal(MOperand::r(r), decimalSource(lhs, r));
+        out.add(op, MOperand::r(r), b);
+        storeDecimal(dst, d, r);
+    }
+
+    // ucomisd leaves CF clear only for ordered greater-or-equal, so < and
+    // <= swap their operands; == and != also test PF for unordered (NaN)
+    void decimalCompare(Opcode op, Operand dst, Operand lhs, Operand rhs) {
+        if (op == Opcode::Lt || op == Opcode::Le) std::swap(lhs, rhs);
+        MOperand a = decimalSource(lhs, SCRATCH_DECIMAL);
+        if (!a.isReg()) {
+            out.add(MOp::Movsd, MOperand::r(SCRATCH_DECIMAL), a);
+            a = MOperand::r(SCRATCH_DECIMAL);
+        }
+        out.add(MOp::Ucomisd, a, decimalSource(rhs, SCRATCH_CONVERT));
+        MOperand al = MOperand::r(SCRATCH, 1), dl = MOperand::r(Reg::rdx, 1);
+        switch (op) {
+        case Opcode::Lt: case Opcode::Gt: out.add(MOp::Setcc, Cond::a, al); break;
+        case Opcode::Le: case Opcode::Ge: out.add(MOp::Setcc, Cond::ae, al); break;
+        case Opcode::Eq:
+            out.add(MOp::Setcc, Cond::e, al);
+            out.add(MOp::Setcc, Cond::np, dl);
+            out.add(MOp::And, al, dl);
+            break;
+        default:
+            out.add(MOp::Setcc, Cond::ne, al);
+            out.add(MOp::Setcc, Cond::p, dl);
+            out.add(MOp::Or, al, dl);
+            break;
+        }
+        out.add(MOp::Movzx, MOperand::r(SCRATCH, 4), al);
+        storeInteger(dst, place(dst));
+    }
+
+    // Branches on a decimal compared with zero; NaN counts as true
+    void decimalBranch(bool ifTrue, Operand cond, uint32_t label) {
+        MOperand zero = MOperand::r(SCRATCH_CONVERT);
+        out.add(MOp::Xorpd, zero, zero);
+        out.add(MOp::Ucomisd, zero, place(cond));
+        if (ifTrue) {
+            out.add(MOp::Jcc, Cond::ne, MOperand::label(label));
+            out.add(MOp::Jcc, Cond::p, MOperand::label(label));
+        } else {
+            uint32_t skip = nextLabel++;
+            out.add(MOp::Jcc, Cond::p, MOperand::label(skip));
+            out.add(MOp::Jcc, Cond::e, MOperand::label(label));
+            out.add(MOp::Label, MOperand::label(skip));
+        }
+    }
+
+    void prologue() {
+        out.add(MOp::Push, MOperand::r(Reg::rbp));
+        out.add(MOp::Mov, MOperand::r(Reg::rbp), MOperand::r(Reg::rsp));
+        // Keep rsp 16-byte aligned for the calls
+        uint32_t frame = (frameSlots * 8 + 15) & ~15u;
+        if (frame) out.add(MOp::Sub, MOperand::r(Reg::rsp), MOperand::imm(frame));
+        for (size_t k = 0; k < allocation.calleeSaved.size(); k++) {
+            out.add(MOp::Mov, MOperand::stack(8 * int64_t(k + 1)), MOperand::r(allocation.calleeSaved[k]));
+        }
+    }
+
+    void epilogue() {
+        for (size_t k = 0; k < allocation.calleeSaved.size(); k++) {
+            out.add(MOp::Mov, MOperand::r(allocation.calleeSaved[k]), MOperand::stack(8 * int64_t(k + 1)));
+        }
+        out.add(MOp::Xor, MOperand::r(Reg::rax, 4), MOperand::r(Reg::rax, 4));
+        out.add(MOp::Leave);
+        out.add(MOp::Ret);
+    }
+
+public:
+    CodeGenerator(const TacCode& code, const Interner& interner, const Allocation& allocation)
+        : code(code), interner(interner), allocation(allocation), constSymbol(code.consts.size(), NONE),
+          frameSlots(static_cast<uint32_t>(allocation.calleeSaved.size()) + allocation.stackSlots),
+          nextLabel(code.labelCount) {}
+
+    MachineCode run(CodegenStats* report) {
+        prologue();
+        for (size_t i = 0; i < code.size(); i++) {
+            Opcode op = code.ops[i];
+            switch (op) {
+            case Opcode::Label:
+                out.add(MOp::Label, MOperand::label(code.dst[i].index()));
+                break;
+            case Opcode::Goto:
+                out.add(MOp::Jmp, MOperand::label(code.dst[i].index()));
+                break;
+            case Opcode::IfFalse:
+            case Opcode::IfTrue:
+                if (decimal(code.lhs[i])) decimalBranch(op == Opcode::IfTrue, code.lhs[i], code.dst[i].index());
+                else branch(op == Opcode::IfFalse ? Cond::e : Cond::ne, place(code.lhs[i]), code.dst[i].index());
+                break;
+            case Opcode::Print:
+                print(code.lhs[i]);
+                break;
+            case Opcode::Assign:
+                assign(code.dst[i], code.lhs[i]);
+                break;
+            default: {
+                Operand dst = code.dst[i], lhs = code.lhs[i], rhs = code.rhs[i];
+                if (decimal(lhs) || decimal(rhs)) {
+                    if (isComparison(op)) decimalCompare(op, dst, lhs, rhs);
+                    else decimalArithmetic(DECIMAL_OPS[uint8_t(op) - uint8_t(Opcode::Add)], dst, lhs, rhs);
+                    break;
+                }
+                MOperand a = place(lhs), b = place(rhs);
+                MOperand d = decimal(dst) ? scratch() : place(dst); // a decimal dst takes the converted result
+                if (op == Opcode::Add) arithmetic(MOp::Add, d, a, b);
+                else if (op == Opcode::Sub) arithmetic(MOp::Sub, d, a, b);
+                else if (op == Opcode::Mul) arithmetic(MOp::Imul, d, a, b);
+                else if (op == Opcode::Div) divide(d, a, b);
+                else compare(conditionOf(op), d, a, b);
+                if (decimal(dst)) storeInteger(dst, place(dst));
+                break;
+            }
+            }
+        }
+        epilogue();
+        if (report) *report = stats;
+        return std::move(out);
+    }
+};
+
+} // namespace
+
+MachineCode generateMachineCode(const TacCode& code, const Interner& interner, const Allocation& allocation, CodegenStats* stats) {
+    return CodeGenerator(code, interner, allocation).run(stats);
+}
+
+void printAllocationReport(std::ostream& out, const Allocation& allocation, const CodegenStats& stats) {
+    out << "register allocation: " << allocation.values << " values, " << allocation.values - allocation.spilled
+        << " in registers, " << allocation.spilled << " spilled to " << allocation.stackSlots << " stack slots\n";
+    out << "memory operands: " << stats.memoryOperandsBefore << " -> " << stats.memoryOperandsAfter << " ("
+        << stats.memoryOperandsBefore - stats.memoryOperandsAfter << " removed)\n";
+}
@@ -0,0 +1,23 @@
+// codegen.h
+#pragma once
+#include "interner.h"
+#include "machine_ir.h"
+#include "register_allocator.h"
+#include "tac.h"
+#include <ostream>
+
+struct CodegenStats {
+    uint32_t memoryOperandsBefore = 0; // variable and temp mentions, each one a memory access without allocation
+    uint32_t memoryOperandsAfter = 0;  // spill slot operands actually emitted
+};
+
+// Selects x86-64 instructions for code as the body of the entry function,
+// reading and writing values where allocation put them. Printing calls
+// the runtime helpers __print_int, __print_string and __print_decimal.
+// Decimals are doubles in SSE registers, with their constants pooled in
+// rodata; mixed operands are converted with cvtsi2sd.
+MachineCode generateMachineCode(const TacCode& code, const Interner& interner, const Allocation& allocation,
+                                CodegenStats* stats = nullptr);
+
+// Spills, stack slots and memory operands removed by allocation
+void printAllocationReport(std::ostream& out, const Allocation& allocation, const CodegenStats& stats);
@@ -0,0 +1,253 @@
+// compile_cache.cpp
+#include "compile_cache.h"
+#include "source_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Bumped when the entry format or key changes
+constexpr uint64_t CACHE_VERSION = 1;
+
+// Temporary files older than this are left over from killed processes
+constexpr time_t STALE_SECONDS = 3600;
+
+// Numbers the stores of this process: batch workers share one pid and may
+// store the same entry at once
+std::atomic<uint64_t> storeSerial{0};
+
+constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t round64(uint64_t acc, uint64_t input) {
+    return rotl(acc + input * P2, 31) * P1;
+}
+
+uint64_t merge(uint64_t acc, uint64_t v) {
+    return (acc ^ round64(0, v)) * P1 + P4;
+}
+
+// mkdir -p
+bool makeDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == std::string::npos) break;
+    }
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool isEntry(const char* name) {
+    return std::strncmp(name, "tmp-", 4) != 0 && std::strcmp(name, "counters") != 0 && name[0] != '.';
+}
+
+} // namespace
+
+// Four lanes of 8-byte rounds over 32-byte stripes, then the tail and a
+// final avalanche (XXH64 as specified by Yann Collet)
+uint64_t xxh64(std::string_view bytes, uint64_t seed) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+    const unsigned char* end = p + bytes.size();
+    uint64_t h;
+    if (bytes.size() >= 32) {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; end - p >= 32; p += 32) {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + P5;
+    }
+    h += bytes.size();
+    for (; end - p >= 8; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * P1 + P4;
+    if (end - p >= 4) {
+        h = rotl(h ^ (uint64_t(read32(p)) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotl(h ^ (*p * P5), 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string CompileCache::defaultDirectory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) return std::string(xdg) + "/mini_compiler";
+    if (const char* home = std::getenv("HOME"); home && *home) return std::string(home) + "/.cache/mini_compiler";
+    return ".mini_compiler_cache";
+}
+
+bool CompileCache::open(const std::string& directory, uint64_t limit) {
+    dir = directory;
+    maxBytes = limit;
+    if (!makeDirectories(dir)) return false;
+    // A rebuilt compiler gets a fresh key space
+    struct stat st {};
+    ::stat("/proc/self/exe", &st);
+    uint64_t identity[4] = {CACHE_VERSION, uint64_t(st.st_size), uint64_t(st.st_mtim.tv_sec), uint64_t(st.st_mtim.tv_nsec)};
+    compiler = xxh64(std::string_view(reinterpret_cast<const char*>(identity), sizeof(identity)));
+    return true;
+}
+
+std::string CompileCache::entryPath(std::string_view source, const char* kind, int optLevel) const {
+    std::string flags = std::string(kind) + " -O" + std::to_string(optLevel);
+    uint64_t key = xxh64(source, xxh64(flags, compiler));
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.%s", static_cast<unsigned long long>(key), kind);
+    return dir + name;
+}
+
+// The layout of the counters file, rewritten in place
+struct CompileCache::Counters {
+    uint64_t bytes; // estimated size of all entries, never below the truth
+    uint64_t hits, misses, bytesSaved;
+};
+
+// Applies change to the counters under an exclusive lock, so concurrent
+// processes never lose each other's updates. A missing or short file
+// starts from a scan of the directory.
+void CompileCache::update(const std::function<void(Counters&)>& change) const {
+    int fd = ::open((dir + "/counters").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    while (::flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+    Counters c{};
+    if (::pread(fd, &c, sizeof(c), 0) != ssize_t(sizeof(c))) {
+        c = Counters{};
+        c.bytes = usage();
+    }
+    change(c);
+    ::pwrite(fd, &c, sizeof(c), 0);
+    ::close(fd); // releases the lock
+}
+
+bool CompileCache::lookup(const std::string& entry, const std::function<bool(std::string_view)>& use) const {
+    SourceBuffer contents;
+    if (!contents.open(entry) || !use(contents.view())) {
+        update([](Counters& c) { c.misses++; });
+        return false;
+    }
+    ::utimensat(AT_FDCWD, entry.c_str(), nullptr, 0);
+    uint64_t size = contents.view().size();
+    update([&](Counters& c) {
+        c.hits++;
+        c.bytesSaved += size;
+    });
+    return true;
+}
+
+bool CompileCache::store(const std::string& entry, const std::function<bool(const std::string&)>& write) const {
+    std::string temp = dir + "/tmp-" + std::to_string(::getpid()) + "-" + std::to_string(storeSerial++) + "-" +
+                       entry.substr(dir.size() + 1);
+    struct stat st;
+    if (!write(temp) || ::stat(temp.c_str(), &st) != 0 || ::rename(temp.c_str(), entry.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    // Replacing an entry counts it twice; the next eviction scan corrects
+    // the estimate
+    update([&](Counters& c) {
+        c.bytes += uint64_t(st.st_size);
+        if (c.bytes > maxBytes) c.bytes = evict();
+    });
+    return true;
+}
+
+// Drops the least recently used entries until the total fits and returns
+// the bytes left. Runs under the counters lock, so one process evicts at a
+// time; a process that never takes the lock just gets ENOENT.
+uint64_t CompileCache::evict() const {
+    struct File {
+        std::string path;
+        uint64_t size;
+        timespec used;
+    };
+    std::vector<File> files;
+    uint64_t total = 0;
+    time_t now = std::time(nullptr);
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return 0;
+    while (dirent* e = ::readdir(d)) {
+        std::string path = dir + "/" + e->d_name;
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (!isEntry(e->d_name)) {
+            if (std::strncmp(e->d_name, "tmp-", 4) == 0 && now - st.st_mtime > STALE_SECONDS) ::unlink(path.c_str());
+            continue;
+        }
+        files.push_back(File{std::move(path), uint64_t(st.st_size), st.st_mtim});
+        total += uint64_t(st.st_size);
+    }
+    ::closedir(d);
+    if (total <= maxBytes) return total;
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (const File& f : files) {
+        if (total <= maxBytes) break;
+        ::unlink(f.path.c_str());
+        total -= f.size;
+    }
+    return total;
+}
+
+uint64_t CompileCache::usage(uint64_t* entries) const {
+    uint64_t total = 0;
+    if (DIR* d = ::opendir(dir.c_str())) {
+        while (dirent* e = ::readdir(d)) {
+            struct stat st;
+            if (!isEntry(e->d_name) || ::stat((dir + "/" + e->d_name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            total += uint64_t(st.st_size);
+            if (entries) ++*entries;
+        }
+        ::closedir(d);
+    }
+    return total;
+}
+
+CacheStats CompileCache::stats() const {
+    CacheStats s;
+    update([&](Counters& c) {
+        s.hits = c.hits;
+        s.misses = c.misses;
+        s.bytesSaved = c.bytesSaved;
+    });
+    s.bytes = usage(&s.entries);
+    return s;
+}
@@ -0,0 +1,57 @@
+// compile_cache.h
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// XXH64 of bytes
+uint64_t xxh64(std::string_view bytes, uint64_t seed = 0);
+
+struct CacheStats {
+    uint64_t hits = 0, misses = 0;
+    uint64_t bytesSaved = 0; // artifact bytes served instead of rebuilt
+    uint64_t entries = 0, bytes = 0;
+};
+
+// Content-addressed store of compiler outputs in a directory that
+// concurrent compiler processes may share. An entry is the artifact
+// itself (a TAC file, assembly or an object), named by the hash of the
+// source plus everything else that decides the output: the compiler
+// binary, the artifact kind and the optimization level. Entries are
+// written under a temporary name and renamed into place, so a reader sees
+// either no entry or a complete one. Hits refresh an entry's mtime. A
+// fixed-size counters file beside the entries holds the hit and miss
+// counts and a running size estimate; only when a store pushes the
+// estimate past the bound does it scan the directory and evict the least
+// recently used entries.
+class CompileCache {
+    struct Counters;
+
+    std::string dir;
+    uint64_t maxBytes = 0;
+    uint64_t compiler = 0; // identifies the compiler binary
+
+    void update(const std::function<void(Counters&)>& change) const;
+    uint64_t evict() const;
+    uint64_t usage(uint64_t* entries = nullptr) const; // bytes in entries, by a scan
+
+public:
+    static std::string defaultDirectory(); // $XDG_CACHE_HOME or ~/.cache
+
+    bool open(const std::string& directory, uint64_t maxBytes); // creates the directory
+
+    std::string entryPath(std::string_view source, const char* kind, int optLevel) const;
+
+    // Calls use with the entry's contents, which are mapped once, so a
+    // concurrent eviction cannot take them away midway. Only when use
+    // succeeds is it a hit, logged and marked as recently used. A missing
+    // entry, including one evicted after the key was computed, is a miss
+    // and so is a failed use; either way the caller compiles.
+    bool lookup(const std::string& entry, const std::function<bool(std::string_view contents)>& use) const;
+
+    // Stores the artifact that write produces at the temporary path it is given
+    bool store(const std::string& entry, const std::function<bool(const std::string&)>& write) const;
+
+    CacheStats stats() const;
+};
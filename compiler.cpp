@@ -0,0 +1,86 @@
+// compiler.cpp
+#include "compiler.h"
+#include "assemblycode_generator.h"
+#include "ast.h"
+#include "elf_writer.h"
+#include "intermediate_code_generator.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parallel_lexer.h"
+#include "parser.h"
+#include "tac_file.h"
+#include "token_stream.h"
+#include "x86_encoder.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Past this many names a context starts over with a fresh interner, so a
+// server fed ever-new identifiers does not grow without bound
+constexpr size_t MAX_WARM_NAMES = 1 << 20;
+
+// Line and column of a lexeme inside source, or 0:0 if it lies elsewhere
+Diagnostic locate(std::string_view source, std::string_view token, std::string message) {
+    Diagnostic d;
+    d.message = std::move(message);
+    uintptr_t begin = uintptr_t(source.data()), at = uintptr_t(token.data());
+    if (at < begin || at > begin + source.size()) return d;
+    std::string_view before = source.substr(0, at - begin);
+    size_t lineStart = before.find_last_of('\n');
+    d.line = uint32_t(std::count(before.begin(), before.end(), '\n') + 1);
+    d.column = uint32_t(before.size() - (lineStart == std::string_view::npos ? 0 : lineStart + 1) + 1);
+    return d;
+}
+
+} // namespace
+
+const char* outputExtension(Emit emit) {
+    return emit == Emit::Tac ? "tac" : emit == Emit::Asm ? "s" : "o";
+}
+
+std::string renderOutput(Emit emit, const TacCode& code, const Interner& interner, std::ostream* report) {
+    if (emit == Emit::Tac) return tacFileImage(code, interner);
+    MachineCode machine = generateAssembly(code, interner, report);
+    if (emit == Emit::Obj) return elfObjectImage(machine, encodeMachineCode(machine));
+    std::ostringstream out;
+    machine.print(out);
+    return out.str();
+}
+
+Compiler::Compiler() : interner(new Interner) {}
+
+CompileResult Compiler::compile(std::string_view source, const CompileOptions& options) {
+    if (interner->size() > MAX_WARM_NAMES) interner.reset(new Interner);
+    arena.reset();
+    CompileResult result;
+    // Tokens are pulled on demand by the parser, or lexed up front in
+    // parallel chunks
+    Lexer lexer(source, *interner);
+    TokenBuffer lexed;
+    if (options.parallelLex) lexed = lexParallel(source, *interner, options.lexThreads);
+    TokenStream tokens = options.parallelLex ? TokenStream(lexed) : TokenStream(lexer);
+    Ast ast(arena);
+    try {
+        Parser parser(tokens, *interner, ast);
+        NodeId program = parser.parse();
+        IntermediateCodeGenerator icg(*interner);
+        icg.generate(ast, program);
+        TacCode& code = icg.getCode();
+        optimize(code, *interner, options.optLevel, options.report);
+        if (options.listing) code.print(*options.listing, *interner);
+        result.output = renderOutput(options.emit, code, *interner, options.report);
+        if (options.keepCode) result.code = std::move(code);
+        result.ok = true;
+    } catch (const SyntaxError& e) {
+        result.diagnostics.push_back(locate(source, e.token, e.what()));
+    } catch (const std::runtime_error& e) {
+        result.diagnostics.push_back(Diagnostic{0, 0, std::string("Error during parsing: ") + e.what()});
+    }
+    return result;
+}
+
+CompileResult compile(std::string_view source, const CompileOptions& options) {
+    Compiler compiler;
+    return compiler.compile(source, options);
+}
@@ -0,0 +1,64 @@
+// compiler.h
+#pragma once
+#include "arena.h"
+#include "interner.h"
+#include "tac.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The whole pipeline as a library: source text in, artifact bytes and
+// diagnostics out. Nothing here exits or touches the filesystem, and it
+// prints only to the streams a caller passes in.
+
+enum class Emit { Tac, Asm, Obj };
+
+const char* outputExtension(Emit emit); // "tac", "s" or "o"
+
+// The artifact for code as bytes, running the backend for assembly and
+// objects
+std::string renderOutput(Emit emit, const TacCode& code, const Interner& interner, std::ostream* report = nullptr);
+
+struct CompileOptions {
+    Emit emit = Emit::Tac;
+    int optLevel = 0;
+    bool parallelLex = false;        // lex in chunks up front instead of on demand
+    unsigned lexThreads = 0;         // for parallelLex; 0: one per core
+    std::ostream* report = nullptr;  // per-pass instruction counts, backend notes
+    std::ostream* listing = nullptr; // the optimized TAC as text
+    bool keepCode = false;           // also return the TAC, e.g. to run it
+};
+
+struct Diagnostic {
+    uint32_t line = 0;   // 1-based; 0 when the error has no source position
+    uint32_t column = 0; // 1-based, in bytes
+    std::string message;
+};
+
+struct CompileResult {
+    bool ok = false;
+    std::string output; // the artifact when ok
+    std::vector<Diagnostic> diagnostics;
+    TacCode code; // when ok and keepCode; its names are the Compiler's
+};
+
+// A reusable compilation context. The arena keeps its blocks and the
+// interner its names between compiles, so a long-lived Compiler skips the
+// warm-up a fresh process pays. Not thread-safe: use one per thread.
+class Compiler {
+    Arena arena;
+    std::unique_ptr<Interner> interner;
+
+public:
+    Compiler();
+
+    CompileResult compile(std::string_view source, const CompileOptions& options = CompileOptions());
+
+    // The names of the last compile's TAC, valid until the next compile
+    const Interner& names() const { return *interner; }
+};
+
+// One-off compile with a fresh context
+CompileResult compile(std::string_view source, const CompileOptions& options = CompileOptions());
@@ -0,0 +1,236 @@
+// dataflow.cpp
+#include "dataflow.h"
+#include "bitset.h"
+#include <algorithm>
+
+uint32_t slotOf(const TacCode& code, Operand operand) {
+    if (operand.kind() == OperandKind::Var) return operand.index();
+    if (operand.kind() == OperandKind::Temp) return static_cast<uint32_t>(code.vars.size()) + operand.index();
+    return Cfg::NONE;
+}
+
+Operand slotOperand(const TacCode& code, uint32_t slot) {
+    uint32_t varCount = static_cast<uint32_t>(code.vars.size());
+    return slot < varCount ? Operand(OperandKind::Var, slot) : Operand(OperandKind::Temp, slot - varCount);
+}
+
+bool Liveness::isLiveIn(uint32_t block, uint32_t slot) const {
+    uint32_t g = globalIndex[slot];
+    if (g == Cfg::NONE) return false;
+    const std::vector<uint32_t>& live = liveIn[block];
+    return std::binary_search(live.begin(), live.end(), g);
+}
+
+namespace {
+
+// Blocks that write each global name, and blocks where it is upward exposed
+struct NameBlocks {
+    std::vector<std::vector<uint32_t>> writes, exposed;
+};
+
+NameBlocks collectNameBlocks(const TacCode& code, const Cfg& cfg, Liveness& live) {
+    size_t slots = code.vars.size() + code.tempTypes.size();
+    uint32_t blockCount = static_cast<uint32_t>(cfg.blocks.size());
+    live.globalIndex.assign(slots, Cfg::NONE);
+
+    // A read is upward exposed unless the same block wrote the slot first
+    NameBlocks names;
+    std::vector<uint32_t> writtenIn(slots, Cfg::NONE), exposedIn(slots, Cfg::NONE);
+    std::vector<std::pair<uint32_t, uint32_t>> writes; // (slot, block)
+    for (uint32_t b = 0; b < blockCount; b++) {
+        auto read = [&](Operand operand) {
+            uint32_t s = slotOf(code, operand);
+            if (s == Cfg::NONE || writtenIn[s] == b || exposedIn[s] == b) return;
+            exposedIn[s] = b;
+            if (live.globalIndex[s] == Cfg::NONE) {
+                live.globalIndex[s] = static_cast<uint32_t>(live.globals.size());
+                live.globals.push_back(s);
+                names.exposed.emplace_back();
+            }
+            names.exposed[live.globalIndex[s]].push_back(b);
+        };
+        for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            read(code.lhs[i]);
+            read(code.rhs[i]);
+            uint32_t d = slotOf(code, code.dst[i]);
+            if (d != Cfg::NONE && writtenIn[d] != b) {
+                writtenIn[d] = b;
+                writes.push_back({d, b});
+            }
+        }
+    }
+
+    // Writes are only known to matter once every global is numbered
+    names.writes.resize(live.globals.size());
+    for (auto [s, b] : writes) {
+        if (live.globalIndex[s] != Cfg::NONE) names.writes[live.globalIndex[s]].push_back(b);
+    }
+    return names;
+}
+
+} // namespace
+
+Liveness computeLiveness(const TacCode& code, const Cfg& cfg) {
+    uint32_t blockCount = static_cast<uint32_t>(cfg.blocks.size());
+    Liveness live;
+    NameBlocks names = collectNameBlocks(code, cfg, live);
+    live.liveIn.assign(blockCount, {});
+    live.liveOut.assign(blockCount, {});
+
+    DenseBitset writes(blockCount), in(blockCount), out(blockCount);
+    std::vector<uint32_t> worklist, touched;
+    for (uint32_t g = 0; g < live.globals.size(); g++) {
+        for (uint32_t b : names.writes[g]) writes.set(b);
+        for (uint32_t b : names.exposed[g]) {
+            if (!cfg.reachable(b)) continue;
+            in.set(b);
+            touched.push_back(b);
+            worklist.push_back(b);
+            live.liveIn[b].push_back(g);
+        }
+        while (!worklist.empty()) {
+            uint32_t b = worklist.back();
+            worklist.pop_back();
+            for (uint32_t p : cfg.blocks[b].preds) {
+                if (!out.test(p)) {
+                    out.set(p);
+                    touched.push_back(p);
+                    live.liveOut[p].push_back(g);
+                }
+                if (!writes.test(p) && !in.test(p)) {
+                    in.set(p);
+                    touched.push_back(p);
+                    worklist.push_back(p);
+                    live.liveIn[p].push_back(g);
+                }
+            }
+        }
+
+        // Clear only what this name touched
+        for (uint32_t b : names.writes[g]) writes.reset(b);
+        for (uint32_t b : touched) {
+            in.reset(b);
+            out.reset(b);
+        }
+        touched.clear();
+    }
+    return live;
+}
+
+std::pair<const uint32_t*, const uint32_t*> ReachingDefinitions::reaching(const Liveness& liveness, uint32_t block, uint32_t slot) const {
+    uint32_t g = liveness.globalIndex[slot];
+    const std::vector<Entry>& entries = in[block];
+    auto it = std::lower_bound(entries.begin(), entries.end(), g, [](const Entry& e, uint32_t v) { return e.global < v; });
+    if (g == Cfg::NONE || it == entries.end() || it->global != g) return {nullptr, nullptr};
+    return {defs.data() + it->begin, defs.data() + it->end};
+}
+
+ReachingDefinitions computeReachingDefinitions(const TacCode& code, const Cfg& cfg, const Liveness& liveness) {
+    uint32_t blockCount = static_cast<uint32_t>(cfg.blocks.size());
+    uint32_t globalCount = static_cast<uint32_t>(liveness.globals.size());
+    ReachingDefinitions reaching;
+    reaching.in.assign(blockCount, {});
+
+    // The last write of each global name in each block, and the blocks
+    // where each name is live on entry
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> lastWrite(globalCount); // (block, instruction)
+    for (uint32_t b = 0; b < blockCount; b++) {
+        for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            uint32_t d = slotOf(code, code.dst[i]);
+            if (d == Cfg::NONE || liveness.globalIndex[d] == Cfg::NONE) continue;
+            auto& writes = lastWrite[liveness.globalIndex[d]];
+            if (!writes.empty() && writes.back().first == b) writes.back().second = i;
+            else writes.push_back({b, i});
+        }
+    }
+    std::vector<std::vector<uint32_t>> region(globalCount);
+    for (uint32_t b = 0; b < blockCount; b++) {
+        for (uint32_t g : liveness.liveIn[b]) region[g].push_back(b);
+    }
+
+    // Per name, iterate the sets on its live range to a fixed point. Sets
+    // are immutable and shared: a block that only passes the name through
+    // points at its predecessor's set instead of copying it.
+    std::vector<std::vector<uint32_t>> pool;
+    std::vector<uint32_t> setOf(blockCount, Cfg::NONE);
+    std::vector<bool> emitted;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    std::vector<uint32_t> writeOf(blockCount, Cfg::NONE), writeSet(blockCount, Cfg::NONE);
+    DenseBitset live(blockCount), queued(blockCount);
+    std::vector<uint32_t> worklist, merged;
+    for (uint32_t g = 0; g < globalCount; g++) {
+        pool.clear();
+        pool.emplace_back(); // the empty set
+        for (auto [b, i] : lastWrite[g]) {
+            writeOf[b] = i;
+            writeSet[b] = static_cast<uint32_t>(pool.size());
+            pool.push_back({i});
+        }
+        for (uint32_t b : region[g]) {
+            live.set(b);
+            setOf[b] = 0;
+        }
+
+        // Region blocks are in block order, which follows the code
+        for (auto it = region[g].rbegin(); it != region[g].rend(); ++it) {
+            queued.set(*it);
+            worklist.push_back(*it);
+        }
+        while (!worklist.empty()) {
+            uint32_t b = worklist.back();
+            worklist.pop_back();
+            queued.reset(b);
+
+            // What each predecessor passes on: its write, or what reached it
+            uint32_t single = Cfg::NONE;
+            bool mixed = false;
+            for (uint32_t p : cfg.blocks[b].preds) {
+                uint32_t set = writeOf[p] != Cfg::NONE ? writeSet[p] : live.test(p) ? setOf[p] : 0;
+                if (set == 0 || set == single) continue;
+                if (single == Cfg::NONE) single = set;
+                else mixed = true;
+            }
+            uint32_t next = single == Cfg::NONE ? 0 : single;
+            if (mixed) {
+                merged.clear();
+                for (uint32_t p : cfg.blocks[b].preds) {
+                    uint32_t set = writeOf[p] != Cfg::NONE ? writeSet[p] : live.test(p) ? setOf[p] : 0;
+                    merged.insert(merged.end(), pool[set].begin(), pool[set].end());
+                }
+                std::sort(merged.begin(), merged.end());
+                merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+                next = pool[setOf[b]] == merged ? setOf[b] : static_cast<uint32_t>(pool.size());
+                if (next == pool.size()) pool.push_back(merged);
+            }
+            if (next == setOf[b] || pool[next] == pool[setOf[b]]) continue;
+            setOf[b] = next;
+
+            // Successors see this block's set only if it passes g through
+            if (writeOf[b] != Cfg::NONE) continue;
+            for (uint32_t s : cfg.blocks[b].succs) {
+                if (live.test(s) && !queued.test(s)) {
+                    queued.set(s);
+                    worklist.push_back(s);
+                }
+            }
+        }
+
+        // Each distinct set is stored once and the entries share it
+        emitted.assign(pool.size(), false);
+        ranges.resize(pool.size());
+        for (uint32_t b : region[g]) {
+            uint32_t set = setOf[b];
+            if (!emitted[set]) {
+                emitted[set] = true;
+                ranges[set].first = static_cast<uint32_t>(reaching.defs.size());
+                reaching.defs.insert(reaching.defs.end(), pool[set].begin(), pool[set].end());
+                ranges[set].second = static_cast<uint32_t>(reaching.defs.size());
+            }
+            reaching.in[b].push_back({g, ranges[set].first, ranges[set].second});
+            live.reset(b);
+            setOf[b] = Cfg::NONE;
+        }
+        for (auto [b, i] : lastWrite[g]) writeOf[b] = writeSet[b] = Cfg::NONE;
+    }
+    return reaching;
+}
@@ -0,0 +1,48 @@
+// dataflow.h
+#pragma once
+#include "cfg.h"
+#include "tac.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Variables occupy slots [0, vars), temps follow; NONE for other operands
+uint32_t slotOf(const TacCode& code, Operand operand);
+Operand slotOperand(const TacCode& code, uint32_t slot);
+
+// Liveness at block boundaries. Only global names, slots read in some
+// block before being written there, can be live at a boundary; they are
+// numbered densely and each block lists the ones live on entry and exit in
+// ascending order.
+//
+// Liveness is solved one name at a time by walking backwards from its
+// upward-exposed reads until a block that writes it, with dense per-block
+// bitsets as the visited and writes-it marks. The cost is proportional to
+// the total size of the live ranges rather than blocks x names, which is
+// what keeps programs of a million instructions tractable.
+struct Liveness {
+    std::vector<uint32_t> globalIndex; // slot -> global number, Cfg::NONE if block-local
+    std::vector<uint32_t> globals;     // global number -> slot
+    std::vector<std::vector<uint32_t>> liveIn, liveOut; // global numbers per block
+
+    bool isLiveIn(uint32_t block, uint32_t slot) const;
+};
+
+Liveness computeLiveness(const TacCode& code, const Cfg& cfg);
+
+// Reaching definitions, pruned to where they matter: for each block and
+// each global name live on entry to it, the instructions whose definition
+// of that name can reach the block. Solved per name over its live range.
+struct ReachingDefinitions {
+    struct Entry {
+        uint32_t global;
+        uint32_t begin, end; // range in defs
+    };
+    std::vector<std::vector<Entry>> in; // per block, ascending by global
+    std::vector<uint32_t> defs;
+
+    // Defining instructions of slot that reach the entry of block
+    std::pair<const uint32_t*, const uint32_t*> reaching(const Liveness& liveness, uint32_t block, uint32_t slot) const;
+};
+
+ReachingDefinitions computeReachingDefinitions(const TacCode& code, const Cfg& cfg, const Liveness& liveness);
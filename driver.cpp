@@ -0,0 +1,152 @@
+// driver.cpp
+#include "driver.h"
+#include "source_buffer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+struct Worker {
+    Compiler compiler;       // stays warm across the worker's files
+    std::string diagnostics; // this worker's messages, sliced per file
+};
+
+struct Span {
+    unsigned worker = 0;
+    size_t begin = 0, end = 0;
+};
+
+bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = std::char_traits<char>::length(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+std::string outputPath(const std::string& source, const BatchOptions& options) {
+    std::string stem = source;
+    if (!options.outputDir.empty()) stem = options.outputDir + "/" + stem.substr(stem.find_last_of('/') + 1);
+    size_t dot = stem.find_last_of('.');
+    if (dot != std::string::npos && dot > stem.find_last_of('/') + 1) stem.resize(dot);
+    return stem + "." + outputExtension(options.emit);
+}
+
+// One file through the whole pipeline; false with a message on failure
+bool compileFile(const std::string& path, const BatchOptions& options, Worker& worker) {
+    SourceBuffer source;
+    if (!source.open(path)) {
+        worker.diagnostics += path + ": failed to open\n";
+        return false;
+    }
+    std::string output = outputPath(path, options);
+    std::string entry;
+    if (options.cache) {
+        entry = options.cache->entryPath(source.view(), outputExtension(options.emit), options.optLevel);
+        if (options.cache->lookup(entry, [&](std::string_view stored) { return writeFile(output, stored); })) return true;
+    }
+
+    CompileResult result = worker.compiler.compile(source.view(), CompileOptions{options.emit, options.optLevel});
+    for (const Diagnostic& d : result.diagnostics) worker.diagnostics += path + ": " + d.message + "\n";
+    if (!result.ok) return false;
+    if (!writeFile(output, result.output)) {
+        worker.diagnostics += path + ": failed to write " + output + "\n";
+        return false;
+    }
+    if (!entry.empty()) options.cache->store(entry, [&](const std::string& temp) { return writeFile(temp, result.output); });
+    return true;
+}
+
+} // namespace
+
+bool writeFile(const std::string& path, std::string_view data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(data.data(), std::streamsize(data.size()));
+    return bool(out.flush());
+}
+
+bool collectInputs(const std::vector<std::string>& args, std::vector<std::string>& paths, std::string& error) {
+    for (const std::string& arg : args) {
+        if (arg.size() > 1 && arg[0] == '@') {
+            std::ifstream list(arg.substr(1));
+            if (!list) {
+                error = "Failed to open " + arg.substr(1);
+                return false;
+            }
+            for (std::string line; std::getline(list, line);) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) paths.push_back(line);
+            }
+            continue;
+        }
+        struct stat st;
+        if (arg != "-" && ::stat(arg.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            DIR* d = ::opendir(arg.c_str());
+            if (!d) {
+                error = "Failed to open " + arg;
+                return false;
+            }
+            std::vector<std::string> found;
+            while (dirent* e = ::readdir(d)) {
+                std::string name = e->d_name;
+                if (endsWith(name, ".custom")) found.push_back(arg + "/" + name);
+            }
+            ::closedir(d);
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+            continue;
+        }
+        paths.push_back(arg);
+    }
+    return true;
+}
+
+BatchResult compileBatch(const std::vector<std::string>& paths, const BatchOptions& options, std::ostream& diagnostics) {
+    auto start = std::chrono::steady_clock::now();
+    WorkStealingPool pool(options.threads);
+    std::vector<Worker> workers(pool.size());
+    std::vector<Span> spans(paths.size());
+    std::vector<char> failed(paths.size(), 0);
+    pool.run(paths.size(), [&](size_t index, unsigned w) {
+        Worker& worker = workers[w];
+        size_t begin = worker.diagnostics.size();
+        failed[index] = !compileFile(paths[index], options, worker);
+        spans[index] = Span{w, begin, worker.diagnostics.size()};
+    });
+
+    BatchResult result;
+    result.threads = pool.size();
+    for (size_t i = 0; i < paths.size(); i++) {
+        const Span& span = spans[i];
+        diagnostics.write(workers[span.worker].diagnostics.data() + span.begin, std::streamsize(span.end - span.begin));
+        result.failed += size_t(failed[i]);
+    }
+    diagnostics.flush();
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void benchmarkBatch(const std::vector<std::string>& paths, BatchOptions options, std::ostream& out) {
+    unsigned most = WorkStealingPool(options.threads).size();
+    options.cache = nullptr; // time the compiler, not the cache
+    double single = 0;
+    for (unsigned threads = 1;; threads = std::min(threads * 2, most)) {
+        options.threads = threads;
+        double best = 0;
+        for (int round = 0; round < 3; round++) {
+            std::ostringstream discarded;
+            double ms = compileBatch(paths, options, discarded).milliseconds;
+            if (round == 0 || ms < best) best = ms;
+        }
+        if (threads == 1) single = best;
+        char line[128];
+        std::snprintf(line, sizeof(line), "batch: %zu files, %u threads, %.1f ms (%.2fx)\n", paths.size(), threads, best,
+                      single / std::max(best, 1e-3));
+        out << line;
+        if (threads == most) break;
+    }
+    out.flush();
+}
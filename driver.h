@@ -0,0 +1,38 @@
+// driver.h
+#pragma once
+#include "compile_cache.h"
+#include "compiler.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+bool writeFile(const std::string& path, std::string_view data); // creates or replaces path
+
+// Expands the command line's inputs: a directory stands for the .custom
+// files in it (sorted by name) and @file for the paths listed in file,
+// one per line
+bool collectInputs(const std::vector<std::string>& args, std::vector<std::string>& paths, std::string& error);
+
+struct BatchOptions {
+    Emit emit = Emit::Tac;
+    int optLevel = 0;
+    std::string outputDir;     // empty: each output goes next to its source
+    unsigned threads = 0;      // 0: one per core
+    const CompileCache* cache = nullptr;
+};
+
+struct BatchResult {
+    size_t failed = 0;
+    double milliseconds = 0;
+    unsigned threads = 0;
+};
+
+// Compiles every source to its own output on a work-stealing pool. Each
+// worker owns a Compiler and a diagnostics buffer, so workers share
+// nothing while compiling. Diagnostics are written to diagnostics
+// in input order once all files are done.
+BatchResult compileBatch(const std::vector<std::string>& paths, const BatchOptions& options, std::ostream& diagnostics);
+
+// Times the batch (best of three) on 1, 2, 4, ... threads up to
+// options.threads
+void benchmarkBatch(const std::vector<std::string>& paths, BatchOptions options, std::ostream& out);
@@ -0,0 +1,153 @@
+// elf_writer.cpp
+#include "elf_writer.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+enum Section : uint16_t { Null, Text, Data, Rodata, RelaText, Symtab, Strtab, Shstrtab, NoteGnuStack, SectionCount };
+
+// Local symbols: the null symbol and one per content section (.text is 1)
+constexpr uint32_t DATA_SYMBOL = 2, RODATA_SYMBOL = 3, FIRST_GLOBAL = 4;
+
+size_t aligned(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+template <typename T>
+void put(std::string& image, const T& value) {
+    image.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32_t addString(std::string& table, const std::string& text) {
+    uint32_t offset = static_cast<uint32_t>(table.size());
+    table += text;
+    table += '\0';
+    return offset;
+}
+
+} // namespace
+
+std::string elfObjectImage(const MachineCode& code, const EncodedCode& encoded) {
+    // Symbol table: locals first, then the entry function and the helpers
+    std::string strtab(1, '\0');
+    std::string symtab;
+    put(symtab, Elf64_Sym{});
+    for (uint16_t section : {Text, Data, Rodata}) {
+        Elf64_Sym sym{};
+        sym.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+        sym.st_shndx = section;
+        put(symtab, sym);
+    }
+    Elf64_Sym entry{};
+    entry.st_name = addString(strtab, code.entry);
+    entry.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+    entry.st_shndx = Text;
+    entry.st_value = encoded.entry;
+    entry.st_size = encoded.text.size() - encoded.entry;
+    put(symtab, entry);
+    std::vector<uint32_t> externalIndex(code.symbols.size(), 0);
+    uint32_t symbols = FIRST_GLOBAL + 1;
+    for (size_t s = 0; s < code.symbols.size(); s++) {
+        if (!code.symbols[s].external) continue;
+        Elf64_Sym sym{};
+        sym.st_name = addString(strtab, code.symbols[s].name);
+        sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        sym.st_shndx = SHN_UNDEF;
+        put(symtab, sym);
+        externalIndex[s] = symbols++;
+    }
+
+    // Data references become section-relative so the data symbols stay local
+    std::string rela;
+    for (const Relocation& r : encoded.relocations) {
+        const MachineCode::Symbol& target = code.symbols[r.symbol];
+        Elf64_Rela entry{};
+        entry.r_offset = r.offset;
+        uint32_t type = r.kind == RelocationKind::Plt32 ? R_X86_64_PLT32 : R_X86_64_PC32;
+        if (target.external) {
+            entry.r_info = ELF64_R_INFO(externalIndex[r.symbol], type);
+            entry.r_addend = r.addend;
+        } else {
+            entry.r_info = ELF64_R_INFO(target.readOnly ? RODATA_SYMBOL : DATA_SYMBOL, type);
+            entry.r_addend = int64_t(encoded.symbolOffset[r.symbol]) + r.addend;
+        }
+        put(rela, entry);
+    }
+
+    std::string shstrtab(1, '\0');
+    Elf64_Shdr headers[SectionCount] = {};
+    auto section = [&](Section index, const char* name, uint32_t type, uint64_t flags, uint64_t align) {
+        headers[index].sh_name = addString(shstrtab, name);
+        headers[index].sh_type = type;
+        headers[index].sh_flags = flags;
+        headers[index].sh_addralign = align;
+    };
+    section(Text, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16);
+    section(Data, ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, 8);
+    section(Rodata, ".rodata", SHT_PROGBITS, SHF_ALLOC, 8);
+    section(RelaText, ".rela.text", SHT_RELA, SHF_INFO_LINK, 8);
+    section(Symtab, ".symtab", SHT_SYMTAB, 0, 8);
+    section(Strtab, ".strtab", SHT_STRTAB, 0, 1);
+    section(Shstrtab, ".shstrtab", SHT_STRTAB, 0, 1);
+    section(NoteGnuStack, ".note.GNU-stack", SHT_PROGBITS, 0, 1); // no executable stack
+    headers[RelaText].sh_link = Symtab;
+    headers[RelaText].sh_info = Text;
+    headers[RelaText].sh_entsize = sizeof(Elf64_Rela);
+    headers[Symtab].sh_link = Strtab;
+    headers[Symtab].sh_info = FIRST_GLOBAL;
+    headers[Symtab].sh_entsize = sizeof(Elf64_Sym);
+
+    // Header, section contents in order, then the section header table
+    std::string image(sizeof(Elf64_Ehdr), '\0');
+    const std::string* contents[SectionCount] = {nullptr, &encoded.text, &encoded.data, &encoded.rodata, &rela,
+                                                 &symtab, &strtab, &shstrtab, nullptr};
+    for (uint16_t s = 1; s < SectionCount; s++) {
+        image.resize(aligned(image.size(), headers[s].sh_addralign), '\0');
+        headers[s].sh_offset = image.size();
+        if (contents[s]) {
+            headers[s].sh_size = contents[s]->size();
+            image += *contents[s];
+        }
+    }
+    image.resize(aligned(image.size(), 8), '\0');
+
+    Elf64_Ehdr ehdr{};
+    ehdr.e_ident[EI_MAG0] = ELFMAG0;
+    ehdr.e_ident[EI_MAG1] = ELFMAG1;
+    ehdr.e_ident[EI_MAG2] = ELFMAG2;
+    ehdr.e_ident[EI_MAG3] = ELFMAG3;
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    ehdr.e_type = ET_REL;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_shoff = image.size();
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = SectionCount;
+    ehdr.e_shstrndx = Shstrtab;
+    image.replace(0, sizeof(ehdr), reinterpret_cast<const char*>(&ehdr), sizeof(ehdr));
+    for (const Elf64_Shdr& header : headers) put(image, header);
+
+    return image;
+}
+
+bool writeElfObject(const std::string& path, const MachineCode& code, const EncodedCode& encoded) {
+    std::string image = elfObjectImage(code, encoded);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < image.size()) {
+        ssize_t w = ::write(fd, image.data() + written, image.size() - written);
+        if (w <= 0) {
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(w);
+    }
+    return close(fd) == 0;
+}
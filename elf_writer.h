@@ -0,0 +1,11 @@
+// elf_writer.h
+#pragma once
+#include "machine_ir.h"
+#include "x86_encoder.h"
+#include <string>
+
+// Writes a relocatable ELF64 x86-64 object with .text, .data, .rodata,
+// .rela.text and a symbol table. The entry function is a global function
+// symbol; external helpers are undefined symbols for the linker.
+std::string elfObjectImage(const MachineCode& code, const EncodedCode& encoded);
+bool writeElfObject(const std::string& path, const MachineCode& code, const EncodedCode& encoded);
@@ -122,104 +122,191 @@
 // }
 
 #include "intermediate_code_generator.h"
-#include <iostream>
-#include <fstream>
-#include <sstream>
 
-std::string IntermediateCodeGenerator::newTemp() {
-    return "t" + std::to_string(tempCount++);
+namespace {
+
+Opcode binaryOpcode(std::string_view op) {
+    if (op == "+") return Opcode::Add;
+    if (op == "-") return Opcode::Sub;
+    if (op == "*") return Opcode::Mul;
+    if (op == "/") return Opcode::Div;
+    if (op == "<") return Opcode::Lt;
+    if (op == ">") return Opcode::Gt;
+    if (op == "<=") return Opcode::Le;
+    if (op == ">=") return Opcode::Ge;
+    if (op == "==") return Opcode::Eq;
+    return Opcode::Ne;
 }
 
-std::string IntermediateCodeGenerator::newLabel() {
-    return "L" + std::to_string(labelCount++);
-}
+} // namespace
+
+IntermediateCodeGenerator::IntermediateCodeGenerator(Interner& interner) : interner(interner) {}
 
-void IntermediateCodeGenerator::emit(const std::string& res, const std::string& arg1, const std::string& op, const std::string& arg2) {
-    code.emplace_back(res, arg1, op, arg2);
+Operand IntermediateCodeGenerator::newTemp(Type type) {
+    return code.newTemp(type);
 }
 
-void IntermediateCodeGenerator::emitLabel(const std::string& label) {
-    code.emplace_back(label + ":", "", "", "");
+Operand IntermediateCodeGenerator::newLabel() {
+    return code.newLabel();
 }
 
-std::string IntermediateCodeGenerator::generateIfCondition(const std::string& cond) {
-    std::string temp = newTemp();
+void IntermediateCodeGenerator::emit(Opcode op, Operand dst, Operand lhs, Operand rhs) {
+    code.add(op, dst, lhs, rhs);
+}
 
-    // Split the condition into lhs, operator, and rhs
-    std::istringstream iss(cond);
-    std::string lhs, op, rhs;
-    iss >> lhs >> op >> rhs;
+void IntermediateCodeGenerator::emitLabel(Operand label) {
+    code.add(Opcode::Label, label);
+}
 
-    if (lhs.empty() || op.empty() || rhs.empty()) {
-        throw std::runtime_error("Invalid condition format: " + cond);
+void IntermediateCodeGenerator::generate(const Ast& ast, NodeId program) {
+    for (const auto& var : ast.vars) {
+        code.vars.push_back(TacVar{var.irName, var.type});
     }
-
-    emit(temp, lhs, op, rhs);  // e.g., t0 = x < 7
-    return temp;
+    generateBlock(ast, program);
 }
 
-void IntermediateCodeGenerator::generateIfElse(const std::string& cond, const std::string& trueLabel, const std::string& falseLabel) {
-    std::string condTemp = generateIfCondition(cond);
-    emit("ifFalse", condTemp, "goto", falseLabel);
-    emit("goto", trueLabel);
+void IntermediateCodeGenerator::generateBlock(const Ast& ast, NodeId block) {
+    for (NodeId stmt = ast[block].a; stmt != 0; stmt = ast[stmt].next) {
+        generateStatement(ast, stmt);
+    }
 }
 
-void IntermediateCodeGenerator::generateWhileStart(const std::string& startLabel) {
-    emitLabel(startLabel);
-}
+void IntermediateCodeGenerator::generateStatement(const Ast& ast, NodeId stmt) {
+    const Node& s = ast[stmt];
+    switch (s.kind) {
+    case NodeKind::VarDecl:
+    case NodeKind::Assign:
+        emit(Opcode::Assign, Operand(OperandKind::Var, s.d), generateExpression(ast, s.a));
+        break;
+
+    case NodeKind::If: {
+        Operand trueLabel = newLabel();
+        Operand falseLabel = newLabel();
+        Operand endLabel = newLabel();
+
+        generateJumpIfFalse(ast, s.a, falseLabel);
+        emit(Opcode::Goto, trueLabel);
+
+        emitLabel(trueLabel);
+        generateBlock(ast, s.b);
+
+        if (s.c) {
+            emit(Opcode::Goto, endLabel);
+            emitLabel(falseLabel);
+            generateBlock(ast, s.c);
+            emitLabel(endLabel);
+        } else {
+            emitLabel(falseLabel);
+        }
+        break;
+    }
 
-void IntermediateCodeGenerator::generateWhileCondition(const std::string& cond, const std::string& startLabel, const std::string& endLabel) {
-    std::string condTemp = generateIfCondition(cond);
-    emit("ifFalse", condTemp, "goto", endLabel);
-}
+    case NodeKind::While: {
+        Operand startLabel = newLabel();
+        Operand endLabel = newLabel();
 
-void IntermediateCodeGenerator::generateForInit(const std::string& init) {
-    emit(init, "");
-}
+        emitLabel(startLabel);
+        generateJumpIfFalse(ast, s.a, endLabel);
+        generateBlock(ast, s.b);
+        emit(Opcode::Goto, startLabel);  // jump back to condition
+        emitLabel(endLabel);             // loop end
+        break;
+    }
+
+    case NodeKind::For: {
+        generateStatement(ast, s.a); // init
+
+        Operand startLabel = newLabel();
+        Operand endLabel = newLabel();
 
-void IntermediateCodeGenerator::generateForCondition(const std::string& cond, const std::string& startLabel, const std::string& endLabel) {
-    std::string condTemp = generateIfCondition(cond);
-    emit("ifFalse", condTemp, "goto", endLabel);
+        emitLabel(startLabel);
+        generateJumpIfFalse(ast, s.b, endLabel);
+        generateBlock(ast, s.d);
+        generateStatement(ast, s.c); // update
+        emit(Opcode::Goto, startLabel);
+        emitLabel(endLabel);
+        break;
+    }
+
+    case NodeKind::Print:
+        // Emit print statement intermediate code as: print toPrint
+        emit(Opcode::Print, Operand(), generateExpression(ast, s.a));
+        break;
+
+    default:
+        break;
+    }
 }
 
-void IntermediateCodeGenerator::generateForIncrement(const std::string& incr, const std::string& startLabel) {
-    emit(incr, "");
-    emit("goto", startLabel);
+Operand IntermediateCodeGenerator::generateExpression(const Ast& ast, NodeId expr) {
+    const Node& e = ast[expr];
+    switch (e.kind) {
+    case NodeKind::Literal:
+        return code.constant(e.value, e.type);
+
+    case NodeKind::Variable:
+        return Operand(OperandKind::Var, e.d);
+
+    case NodeKind::Binary: {
+        Operand lhs = generateExpression(ast, e.a);
+        Operand rhs = generateExpression(ast, e.b);
+        Operand temp = newTemp(e.type);
+        emit(binaryOpcode(interner.name(e.value)), temp, lhs, rhs);  // e.g., t0 = x < 7
+        return temp;
+    }
+
+    case NodeKind::And:
+    case NodeKind::Or: {
+        // Materialize a logical value as 0/1 through the branching form
+        Operand temp = newTemp(Type::Integer);
+        Operand falseLabel = newLabel();
+        Operand endLabel = newLabel();
+        generateJumpIfFalse(ast, expr, falseLabel);
+        emit(Opcode::Assign, temp, code.constant(interner.intern("1"), Type::Integer));
+        emit(Opcode::Goto, endLabel);
+        emitLabel(falseLabel);
+        emit(Opcode::Assign, temp, code.constant(interner.intern("0"), Type::Integer));
+        emitLabel(endLabel);
+        return temp;
+    }
+    default:
+        break;
+    }
+    return Operand();
 }
 
-void IntermediateCodeGenerator::printCode() {
-    for (const auto& instr : code) {
-        if (instr.op.empty() && instr.arg2.empty() && !instr.arg1.empty()) {
-            std::cout << instr.result << " " << instr.arg1 << std::endl;
-        } else if (instr.op.empty() && instr.arg1.empty() && instr.arg2.empty()) {
-            std::cout << instr.result << std::endl;
-        } else if (instr.result == "ifFalse") {
-            std::cout << "ifFalse " << instr.arg1 << " goto " << instr.arg2 << std::endl;
-        } else if (instr.op == "goto") {
-            std::cout << "goto " << instr.arg2 << std::endl;
-        } else if (instr.op == "=" && instr.arg2.empty()) {
-            std::cout << instr.result << " = " << instr.arg1 << std::endl;
-        } else {
-            std::cout << instr.result << " = " << instr.arg1 << " " << instr.op << " " << instr.arg2 << std::endl;
-        }
+void IntermediateCodeGenerator::generateJumpIfFalse(const Ast& ast, NodeId cond, Operand falseLabel) {
+    const Node& e = ast[cond];
+    if (e.kind == NodeKind::And) {
+        generateJumpIfFalse(ast, e.a, falseLabel);
+        generateJumpIfFalse(ast, e.b, falseLabel);
+    } else if (e.kind == NodeKind::Or) {
+        Operand trueLabel = newLabel();
+        generateJumpIfTrue(ast, e.a, trueLabel);
+        generateJumpIfFalse(ast, e.b, falseLabel);
+        emitLabel(trueLabel);
+    } else {
+        Operand condValue = generateExpression(ast, cond);
+        emit(Opcode::IfFalse, falseLabel, condValue);
     }
 }
 
-void IntermediateCodeGenerator::writeToFile(const std::string& filename) {
-    std::ofstream outfile(filename);
-    for (const auto& instr : code) {
-        if (instr.op.empty() && instr.arg2.empty() && !instr.arg1.empty()) {
-            outfile << instr.result << " " << instr.arg1 << "\n";
-        } else if (instr.op.empty() && instr.arg1.empty() && instr.arg2.empty()) {
-            outfile << instr.result << "\n";
-        } else if (instr.result == "ifFalse") {
-            outfile << "ifFalse " << instr.arg1 << " goto " << instr.arg2 << "\n";
-        } else if (instr.op == "goto") {
-            outfile << "goto " << instr.arg2 << "\n";
-        } else if (instr.op == "=" && instr.arg2.empty()) {
-            outfile << instr.result << " = " << instr.arg1 << "\n";
-        } else {
-            outfile << instr.result << " = " << instr.arg1 << " " << instr.op << " " << instr.arg2 << "\n";
-        }
+void IntermediateCodeGenerator::generateJumpIfTrue(const Ast& ast, NodeId cond, Operand trueLabel) {
+    const Node& e = ast[cond];
+    if (e.kind == NodeKind::Or) {
+        generateJumpIfTrue(ast, e.a, trueLabel);
+        generateJumpIfTrue(ast, e.b, trueLabel);
+    } else if (e.kind == NodeKind::And) {
+        Operand falseLabel = newLabel();
+        generateJumpIfFalse(ast, e.a, falseLabel);
+        generateJumpIfTrue(ast, e.b, trueLabel);
+        emitLabel(falseLabel);
+    } else {
+        Operand condValue = generateExpression(ast, cond);
+        emit(Opcode::IfTrue, trueLabel, condValue);
     }
 }
+
+TacCode& IntermediateCodeGenerator::getCode() {
+    return code;
+}
@@ -1,34 +1,34 @@
 #pragma once
+#include "interner.h"
+#include "ast.h"
+#include "tac.h"
 #include <string>
 #include <vector>
 #include <fstream>
 
-struct Instruction {
-    std::string result, arg1, op, arg2;
-    Instruction(const std::string& r, const std::string& a1, const std::string& o, const std::string& a2)
-        : result(r), arg1(a1), op(o), arg2(a2) {}
-};
-
 class IntermediateCodeGenerator {
-    std::vector<Instruction> code;
-    int tempCount = 0;
-    int labelCount = 0;
+    Interner& interner;
+    TacCode code;
+
+    void generateBlock(const Ast& ast, NodeId block);
+    void generateStatement(const Ast& ast, NodeId stmt);
+    // Returns the operand holding the expression's value
+    Operand generateExpression(const Ast& ast, NodeId expr);
+    // Conditions branch with short-circuit evaluation of && and ||
+    void generateJumpIfFalse(const Ast& ast, NodeId cond, Operand falseLabel);
+    void generateJumpIfTrue(const Ast& ast, NodeId cond, Operand trueLabel);
 
 public:
-    std::string newTemp();
-    std::string newLabel();
+    explicit IntermediateCodeGenerator(Interner& interner);
 
-    void emit(const std::string& res, const std::string& arg1, const std::string& op = "", const std::string& arg2 = "");
-    void emitLabel(const std::string& label);
+    Operand newTemp(Type type);
+    Operand newLabel();
 
-    std::string generateIfCondition(const std::string& cond);
-    void generateIfElse(const std::string& cond, const std::string& trueLabel, const std::string& falseLabel);
-    void generateWhileStart(const std::string& startLabel);
-    void generateWhileCondition(const std::string& cond, const std::string& startLabel, const std::string& endLabel);
-    void generateForInit(const std::string& init);
-    void generateForCondition(const std::string& cond, const std::string& startLabel, const std::string& endLabel);
-    void generateForIncrement(const std::string& incr, const std::string& startLabel);
+    void emit(Opcode op, Operand dst, Operand lhs = Operand(), Operand rhs = Operand());
+    void emitLabel(Operand label);
 
-    void printCode();
-    void writeToFile(const std::string& filename);
-};
\ No newline at end of file
+    // Lowers a parsed program (a Block node) to TAC
+    void generate(const Ast& ast, NodeId program);
+
+    TacCode& getCode();
+};
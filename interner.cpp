@@ -0,0 +1,70 @@
+// interner.cpp
+#include "interner.h"
+#include <cstring>
+
+namespace {
+
+uint32_t hashText(std::string_view text) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+} // namespace
+
+Interner::Interner() : slots(256, 0) {
+    intern("");
+}
+
+std::string_view Interner::store(std::string_view text) {
+    if (text.size() > BLOCK_SIZE / 4) {
+        // Large literals get a block of their own, outside the bump chain
+        blocks.emplace_back(new char[text.size()]);
+        std::memcpy(blocks.back().get(), text.data(), text.size());
+        return std::string_view(blocks.back().get(), text.size());
+    }
+    if (!current || blockUsed + text.size() > BLOCK_SIZE) {
+        blocks.emplace_back(new char[BLOCK_SIZE]);
+        current = blocks.back().get();
+        blockUsed = 0;
+    }
+    char* dst = current + blockUsed;
+    std::memcpy(dst, text.data(), text.size());
+    blockUsed += text.size();
+    return std::string_view(dst, text.size());
+}
+
+void Interner::grow() {
+    std::vector<SymbolId> bigger(slots.size() * 2, 0);
+    size_t mask = bigger.size() - 1;
+    for (SymbolId id = 0; id < names.size(); id++) {
+        size_t i = hashes[id] & mask;
+        while (bigger[i] != 0) i = (i + 1) & mask;
+        bigger[i] = id + 1;
+    }
+    slots.swap(bigger);
+}
+
+SymbolId Interner::intern(std::string_view text) {
+    uint32_t h = hashText(text);
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    while (slots[i] != 0) {
+        SymbolId id = slots[i] - 1;
+        if (hashes[id] == h && names[id] == text) return id;
+        i = (i + 1) & mask;
+    }
+
+    SymbolId id = static_cast<SymbolId>(names.size());
+    names.push_back(store(text));
+    hashes.push_back(h);
+    slots[i] = id + 1;
+
+    // Keep the load factor at or below 1/2
+    if (names.size() * 2 > slots.size()) grow();
+    return id;
+}
@@ -0,0 +1,37 @@
+// interner.h
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using SymbolId = uint32_t;
+
+// Interning arena shared by the lexer, symbol table and code generators.
+// Every distinct spelling is stored once and identified by a dense 32-bit
+// id, so name comparisons downstream are integer comparisons. Id 0 is
+// always the empty string. Returned views stay valid for the lifetime of
+// the interner.
+class Interner {
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* current = nullptr; // block small names are bumped into
+    size_t blockUsed = BLOCK_SIZE;
+
+    std::vector<std::string_view> names; // id -> spelling
+    std::vector<uint32_t> hashes;        // id -> hash, kept for rehashing
+    std::vector<SymbolId> slots;         // open addressing, id + 1 (0 = empty)
+
+    std::string_view store(std::string_view text);
+    void grow();
+
+public:
+    Interner();
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    SymbolId intern(std::string_view text);
+    std::string_view name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
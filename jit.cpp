@@ -0,0 +1,111 @@
+// jit.cpp
+#include "jit.h"
+#include "runtime_output.h"
+#include <csetjmp>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// Where a runtime error raised inside the running code resumes. The code
+// has no destructors to run, so jumping out of its frames is safe.
+thread_local std::jmp_buf* runtimeError = nullptr;
+
+[[noreturn]] void divisionByZero() {
+    std::longjmp(*runtimeError, 1);
+}
+
+const struct {
+    const char* name;
+    const void* address;
+} HELPERS[] = {
+    {"__print_int", reinterpret_cast<const void*>(&printInt)},
+    {"__print_string", reinterpret_cast<const void*>(&printString)},
+    {"__print_decimal", reinterpret_cast<const void*>(&printDecimal)},
+    {"__division_by_zero", reinterpret_cast<const void*>(&divisionByZero)},
+};
+
+const void* helper(const std::string& name) {
+    for (const auto& h : HELPERS) {
+        if (name == h.name) return h.address;
+    }
+    return nullptr;
+}
+
+// jmp qword ptr [rip]; .quad address: helpers can be anywhere in the
+// address space, out of reach of a rel32 call
+constexpr size_t STUB_SIZE = 16;
+
+size_t pageAligned(size_t n) {
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    return (n + page - 1) / page * page;
+}
+
+} // namespace
+
+JitImage::~JitImage() {
+    if (base) munmap(base, size);
+}
+
+bool JitImage::load(const MachineCode& code, const EncodedCode& encoded) {
+    // text and helper stubs | rodata | data, each on its own pages
+    std::vector<uint64_t> stub(code.symbols.size(), 0);
+    size_t textSize = encoded.text.size();
+    for (size_t s = 0; s < code.symbols.size(); s++) {
+        if (!code.symbols[s].external) continue;
+        textSize = (textSize + STUB_SIZE - 1) / STUB_SIZE * STUB_SIZE;
+        stub[s] = textSize;
+        textSize += STUB_SIZE;
+    }
+    size_t rodataOffset = pageAligned(textSize);
+    size_t dataOffset = rodataOffset + pageAligned(encoded.rodata.size());
+    size = dataOffset + pageAligned(encoded.data.size());
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return false;
+    base = static_cast<char*>(mapping);
+    std::memcpy(base, encoded.text.data(), encoded.text.size());
+    std::memcpy(base + rodataOffset, encoded.rodata.data(), encoded.rodata.size());
+    std::memcpy(base + dataOffset, encoded.data.data(), encoded.data.size());
+
+    for (size_t s = 0; s < code.symbols.size(); s++) {
+        if (!code.symbols[s].external) continue;
+        const void* address = helper(code.symbols[s].name);
+        if (!address) return false;
+        static const unsigned char jump[6] = {0xFF, 0x25, 0, 0, 0, 0};
+        std::memcpy(base + stub[s], jump, sizeof(jump));
+        std::memcpy(base + stub[s] + sizeof(jump), &address, sizeof(address));
+    }
+
+    for (const Relocation& r : encoded.relocations) {
+        const MachineCode::Symbol& symbol = code.symbols[r.symbol];
+        uint64_t target = symbol.external ? stub[r.symbol]
+                          : (symbol.readOnly ? rodataOffset : dataOffset) + encoded.symbolOffset[r.symbol];
+        int32_t value = int32_t(int64_t(target) + r.addend - int64_t(r.offset));
+        std::memcpy(base + r.offset, &value, sizeof(value));
+    }
+
+    entry = encoded.entry;
+    if (mprotect(base, rodataOffset, PROT_READ | PROT_EXEC) != 0) return false;
+    if (dataOffset > rodataOffset && mprotect(base + rodataOffset, dataOffset - rodataOffset, PROT_READ) != 0) return false;
+    return true;
+}
+
+bool JitImage::run(int& status, std::string& error) const {
+    flushOutput();
+    auto function = reinterpret_cast<int (*)()>(base + entry);
+    std::jmp_buf target;
+    runtimeError = &target;
+    if (setjmp(target) != 0) {
+        runtimeError = nullptr;
+        flushOutput();
+        error = "division by zero";
+        return false;
+    }
+    status = function();
+    runtimeError = nullptr;
+    flushOutput();
+    return true;
+}
@@ -0,0 +1,30 @@
+// jit.h
+#pragma once
+#include "machine_ir.h"
+#include "x86_encoder.h"
+#include <cstddef>
+#include <string>
+
+// Encoded code loaded into its own mapping and linked against in-process
+// print helpers. The mapping is filled while writable, then text becomes
+// read+execute, rodata read-only and data read+write; no page is ever
+// writable and executable at once.
+class JitImage {
+    char* base = nullptr;
+    size_t size = 0;
+    uint64_t entry = 0;
+
+public:
+    JitImage() = default;
+    JitImage(const JitImage&) = delete;
+    JitImage& operator=(const JitImage&) = delete;
+    ~JitImage();
+
+    // False if mapping fails or the code calls an unknown helper
+    bool load(const MachineCode& code, const EncodedCode& encoded);
+
+    // Runs the entry function and sets its exit status; its output is
+    // flushed before returning. False with error set if the program hit a
+    // runtime error such as division by zero.
+    bool run(int& status, std::string& error) const;
+};
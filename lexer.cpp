@@ -1,11 +1,104 @@
 #include "lexer.h"
+#include "simd_scan.h"
+#include <cstdint>
 
-// Helper function to check if char is part of operator
-bool isOperatorChar(char c) {
-    return c == '+' || c == '-' || c == '*' || c == '/' || c == '<' || c == '>' || c == '=' || c == '!';
+namespace {
+
+// Character classes driving getNextToken()'s dispatch
+enum CharClass : uint8_t {
+    CC_UNKNOWN,
+    CC_END,      // '\0'
+    CC_SPACE,
+    CC_DIGIT,
+    CC_ALPHA,    // letters and '_' (identifier start)
+    CC_QUOTE,
+    CC_EQUALS,
+    CC_OPERATOR, // + - * / < > ! & |
+    CC_PUNCT     // ; , { } ( )
+};
+
+struct CharTable {
+    uint8_t cls[256];
+    bool ident[256]; // identifier continuation: letters, digits, '_'
+};
+
+constexpr CharTable buildCharTable() {
+    CharTable t{};
+    for (int c = 0; c < 256; c++) {
+        t.cls[c] = CC_UNKNOWN;
+        t.ident[c] = false;
+    }
+    t.cls[0] = CC_END;
+    for (char c : {' ', '\t', '\n', '\r', '\v', '\f'}) t.cls[(unsigned char)c] = CC_SPACE;
+    for (int c = '0'; c <= '9'; c++) {
+        t.cls[c] = CC_DIGIT;
+        t.ident[c] = true;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        t.cls[c] = t.cls[c - 'a' + 'A'] = CC_ALPHA;
+        t.ident[c] = t.ident[c - 'a' + 'A'] = true;
+    }
+    t.cls['_'] = CC_ALPHA;
+    t.ident['_'] = true;
+    t.cls['"'] = CC_QUOTE;
+    t.cls['='] = CC_EQUALS;
+    for (char c : {'+', '-', '*', '/', '<', '>', '!', '&', '|'}) t.cls[(unsigned char)c] = CC_OPERATOR;
+    for (char c : {';', ',', '{', '}', '(', ')'}) t.cls[(unsigned char)c] = CC_PUNCT;
+    return t;
+}
+
+constexpr CharTable chars = buildCharTable();
+
+inline uint8_t classOf(char c) { return chars.cls[(unsigned char)c]; }
+inline bool isIdentChar(char c) { return chars.ident[(unsigned char)c]; }
+
+// Keywords are looked up through a perfect hash on (first char, last char,
+// length); the table is built and checked for collisions at compile time.
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword keywords[] = {
+    {"integer", TokenType::INTEGER_TYPE},
+    {"decimal", TokenType::DECIMAL_TYPE},
+    {"string", TokenType::STRING_TYPE},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"while", TokenType::WHILE},
+    {"for", TokenType::FOR},
+    {"print", TokenType::PRINT},
+};
+
+constexpr size_t KEYWORD_SLOTS = 16;
+
+constexpr size_t keywordHash(std::string_view s) {
+    return (((unsigned char)s.front() << 3) + ((unsigned char)s.back() << 4) + s.size()) & (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable {
+    Keyword slots[KEYWORD_SLOTS];
+    bool perfect;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable t{};
+    t.perfect = true;
+    for (auto& slot : t.slots) slot = {"", TokenType::IDENTIFIER};
+    for (const auto& kw : keywords) {
+        auto& slot = t.slots[keywordHash(kw.text)];
+        if (!slot.text.empty()) t.perfect = false;
+        slot = kw;
+    }
+    return t;
 }
 
-Lexer::Lexer(const std::string& src) : source(src), pos(0) {
+constexpr KeywordTable keywordTable = buildKeywordTable();
+static_assert(keywordTable.perfect, "keyword hash has collisions");
+
+} // namespace
+
+Lexer::Lexer(std::string_view src, Interner& interner) : source(src), interner(interner), pos(0) {
     currentChar = pos < source.size() ? source[pos] : '\0';
 }
 
@@ -14,143 +107,164 @@ void Lexer::advance() {
     currentChar = pos < source.size() ? source[pos] : '\0';
 }
 
+void Lexer::seek(size_t newPos) {
+    pos = newPos < source.size() ? newPos : source.size();
+    currentChar = pos < source.size() ? source[pos] : '\0';
+}
+
 void Lexer::skipWhitespace() {
-    while (isspace(currentChar)) {
+    seek(pos + scanPastWhitespace(source.data() + pos, source.size() - pos));
+}
+
+size_t Lexer::scanTo(char terminator) {
+    // An embedded '\0' ends the input just like the end of the buffer
+    return pos + scanForEither(source.data() + pos, source.size() - pos, terminator, '\0');
+}
+
+void Lexer::skipComment() {
+    if (source[pos + 1] == '/') {
+        seek(scanTo('\n')); // the newline itself is whitespace
+        return;
+    }
+
+    // Block comment: find each '*' and stop at the first one followed by '/'
+    seek(pos + 2);
+    while (currentChar != '\0') {
+        seek(scanTo('*'));
+        if (currentChar != '*') break;
+        if (pos + 1 < source.size() && source[pos + 1] == '/') {
+            seek(pos + 2);
+            return;
+        }
         advance();
     }
+    // Unterminated block comment runs to end of input
 }
 
 Token Lexer::number() {
-    std::string result;
+    size_t start = pos;
     bool hasDot = false;
-    while (isdigit(currentChar) || currentChar == '.') {
+    while (classOf(currentChar) == CC_DIGIT || currentChar == '.') {
         if (currentChar == '.') {
             if (hasDot) break; // only one dot allowed
             hasDot = true;
         }
-        result += currentChar;
         advance();
     }
-    return Token(TokenType::NUMBER, result);
+    std::string_view result = source.substr(start, pos - start);
+    return Token(TokenType::NUMBER, result, interner.intern(result));
 }
 
 Token Lexer::identifierOrKeyword() {
-    std::string result;
-    while (isalnum(currentChar) || currentChar == '_') {
-        result += currentChar;
+    size_t start = pos;
+    while (isIdentChar(currentChar)) {
         advance();
     }
+    std::string_view result = source.substr(start, pos - start);
 
     // Check keywords
-    if (result == "integer") return Token(TokenType::INTEGER_TYPE, result);
-    if (result == "decimal") return Token(TokenType::DECIMAL_TYPE, result);
-    if (result == "string") return Token(TokenType::STRING_TYPE, result);
-    if (result == "if") return Token(TokenType::IF, result);
-    if (result == "else") return Token(TokenType::ELSE, result);
-    if (result == "while") return Token(TokenType::WHILE, result);
-    if (result == "for") return Token(TokenType::FOR, result);
-    if (result == "print") return Token(TokenType::PRINT, result);
-
-    return Token(TokenType::IDENTIFIER, result);
+    const Keyword& kw = keywordTable.slots[keywordHash(result)];
+    if (kw.text == result) return Token(kw.type, result);
+
+    return Token(TokenType::IDENTIFIER, result, interner.intern(result));
 }
 
 Token Lexer::quotedCondition() {
-    std::string result;
     advance(); // skip opening quote
-    while (currentChar != '"' && currentChar != '\0') {
-        result += currentChar;
-        advance();
-    }
+    size_t start = pos;
+    seek(scanTo('"'));
+    std::string_view result = source.substr(start, pos - start);
     if (currentChar == '"') advance(); // skip closing quote
-    return Token(TokenType::QUOTED_CONDITION, result);
+    return Token(TokenType::QUOTED_CONDITION, result, interner.intern(result));
 }
 
 Token Lexer::stringLiteral() {
-    std::string result;
     advance(); // skip opening quote
-    while (currentChar != '"' && currentChar != '\0') {
-        result += currentChar;
-        advance();
-    }
+    size_t start = pos;
+    seek(scanTo('"'));
+    std::string_view result = source.substr(start, pos - start);
     if (currentChar == '"') advance(); // skip closing quote
-    return Token(TokenType::STRING_LITERAL, result); // ✅ important
+    return Token(TokenType::STRING_LITERAL, result, interner.intern(result)); // ✅ important
 }
 
 Token Lexer::getNextToken() {
-    while (currentChar != '\0') {
-        if (isspace(currentChar)) {
+    for (;;) {
+        switch (classOf(currentChar)) {
+        case CC_END:
+            return Token(TokenType::END_OF_FILE, source.substr(pos, 0));
+
+        case CC_SPACE:
             skipWhitespace();
             continue;
-        }
 
         // Handle assignment operator ===
-        if (currentChar == '=') {
-            if (pos + 2 < source.size() && source[pos] == '=' && source[pos+1] == '=' && source[pos+2] == '=') {
+        case CC_EQUALS:
+            if (pos + 2 < source.size() && source[pos + 1] == '=' && source[pos + 2] == '=') {
+                std::string_view text = source.substr(pos, 3);
                 pos += 3;
                 currentChar = pos < source.size() ? source[pos] : '\0';
-                return Token(TokenType::ASSIGN, "===");
-            } else {
-                // Unknown single '=' - invalid in your language
-                advance();
-                return Token(TokenType::UNKNOWN, "=");
+                return Token(TokenType::ASSIGN, text);
             }
-        }
-
-        // Semicolon
-        if (currentChar == ';') {
-            advance();
-            return Token(TokenType::SEMICOLON, ";");
-        }
-
-        // Comma
-        if (currentChar == ',') {
+            // Equality operator ==
+            if (pos + 1 < source.size() && source[pos + 1] == '=') {
+                std::string_view text = source.substr(pos, 2);
+                pos += 2;
+                currentChar = pos < source.size() ? source[pos] : '\0';
+                return Token(TokenType::OPERATOR, text);
+            }
+            // Unknown single '=' - invalid in your language
             advance();
-            return Token(TokenType::COMMA, ",");
-        }
+            return Token(TokenType::UNKNOWN, source.substr(pos - 1, 1));
 
-        // Braces
-        if (currentChar == '{') {
-            advance();
-            return Token(TokenType::LBRACE, "{");
-        }
-        if (currentChar == '}') {
+        // Semicolon, comma, braces and parentheses
+        case CC_PUNCT: {
+            char c = currentChar;
+            std::string_view text = source.substr(pos, 1);
             advance();
-            return Token(TokenType::RBRACE, "}");
+            if (c == ';') return Token(TokenType::SEMICOLON, text);
+            if (c == ',') return Token(TokenType::COMMA, text);
+            if (c == '{') return Token(TokenType::LBRACE, text);
+            if (c == '}') return Token(TokenType::RBRACE, text);
+            if (c == '(') return Token(TokenType::LPAREN, text);
+            return Token(TokenType::RPAREN, text);
         }
 
         // Double-quoted strings (now always as STRING_LITERAL)
-        if (currentChar == '"') {
+        case CC_QUOTE:
             return stringLiteral();
-        }
 
         // Number (integer or decimal)
-        if (isdigit(currentChar)) {
+        case CC_DIGIT:
             return number();
-        }
 
         // Identifier or keyword
-        if (isalpha(currentChar) || currentChar == '_') {
+        case CC_ALPHA:
             return identifierOrKeyword();
-        }
 
-        // Operators (+, -, *, /, <, >, <=, >=, ==, !=)
-        if (isOperatorChar(currentChar)) {
-            std::string op;
-            op += currentChar;
+        // Operators (+, -, *, /, <, >, <=, >=, !=, &&, ||, ++, --) and comments
+        case CC_OPERATOR: {
+            if (currentChar == '/' && pos + 1 < source.size() && (source[pos + 1] == '/' || source[pos + 1] == '*')) {
+                skipComment();
+                continue;
+            }
+            size_t start = pos;
+            char first = currentChar;
             advance();
             // Check for two-char operators
-            if ((op[0] == '<' || op[0] == '>' || op[0] == '=' || op[0] == '!') && currentChar == '=') {
-                op += currentChar;
+            if ((first == '<' || first == '>' || first == '!') && currentChar == '=') {
+                advance();
+            } else if ((first == '&' || first == '|' || first == '+' || first == '-') && currentChar == first) {
                 advance();
             }
-            return Token(TokenType::OPERATOR, op);
+            return Token(TokenType::OPERATOR, source.substr(start, pos - start));
         }
 
         // Unknown character
-        std::string unknownChar(1, currentChar);
-        advance();
-        return Token(TokenType::UNKNOWN, unknownChar);
+        default: {
+            std::string_view unknownChar = source.substr(pos, 1);
+            advance();
+            return Token(TokenType::UNKNOWN, unknownChar);
+        }
+        }
     }
-
-    return Token(TokenType::END_OF_FILE, "");
 }
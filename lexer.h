@@ -2,10 +2,12 @@
 #define LEXER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cctype>
 #include <iostream>
 #include <fstream>
+#include "interner.h"
 
 enum class TokenType {
     IDENTIFIER,
@@ -27,32 +29,42 @@ enum class TokenType {
     PRINT,
     LBRACE,
     RBRACE,
+    LPAREN,
+    RPAREN,
     END_OF_FILE
 };
 
 
+// Lexemes point into the source buffer the Lexer was constructed with, so
+// that buffer must outlive every token produced from it. Identifiers and
+// literals also carry their interned id; other tokens have id 0.
 struct Token {
     TokenType type;
-    std::string lexeme;
-    Token() : type(TokenType::END_OF_FILE), lexeme("") {}
-    Token(TokenType t, const std::string& l) : type(t), lexeme(l) {}
+    std::string_view lexeme;
+    SymbolId id;
+    Token() : type(TokenType::END_OF_FILE), lexeme(""), id(0) {}
+    Token(TokenType t, std::string_view l, SymbolId i = 0) : type(t), lexeme(l), id(i) {}
 };
 
 class Lexer {
 private:
-    std::string source;
+    std::string_view source;
+    Interner& interner;
     size_t pos;
     char currentChar;
 
     void advance();
+    void seek(size_t newPos);
+    size_t scanTo(char terminator);
     void skipWhitespace();
+    void skipComment();
     Token number();
     Token identifierOrKeyword();
     Token quotedCondition();
     Token stringLiteral();
 
 public:
-    Lexer(const std::string& src);
+    Lexer(std::string_view src, Interner& interner);
     Token getNextToken();
     bool isAtEnd();
 };
@@ -0,0 +1,343 @@
+// loops.cpp
+#include "loops.h"
+#include "dataflow.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+std::vector<Loop> findLoops(const Cfg& cfg) {
+    uint32_t blockCount = static_cast<uint32_t>(cfg.blocks.size());
+    std::vector<Loop> loops;
+    std::vector<uint32_t> loopOfHeader(blockCount, Cfg::NONE);
+    for (uint32_t b : cfg.rpo) {
+        for (uint32_t h : cfg.blocks[b].succs) {
+            if (!cfg.dominates(h, b)) continue;
+            if (loopOfHeader[h] == Cfg::NONE) {
+                loopOfHeader[h] = static_cast<uint32_t>(loops.size());
+                loops.push_back(Loop{h, {}, {}});
+            }
+            loops[loopOfHeader[h]].latches.push_back(b);
+        }
+    }
+
+    // Body: the header plus everything that reaches a latch without
+    // passing through the header
+    std::vector<uint32_t> mark(blockCount, Cfg::NONE), worklist;
+    for (uint32_t l = 0; l < loops.size(); l++) {
+        Loop& loop = loops[l];
+        mark[loop.header] = l;
+        loop.blocks.push_back(loop.header);
+        for (uint32_t latch : loop.latches) {
+            if (mark[latch] == l) continue;
+            mark[latch] = l;
+            loop.blocks.push_back(latch);
+            worklist.push_back(latch);
+        }
+        while (!worklist.empty()) {
+            uint32_t b = worklist.back();
+            worklist.pop_back();
+            for (uint32_t p : cfg.blocks[b].preds) {
+                if (mark[p] == l || !cfg.reachable(p)) continue;
+                mark[p] = l;
+                loop.blocks.push_back(p);
+                worklist.push_back(p);
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+    }
+
+    // Visiting larger loops first leaves each block owned by its innermost
+    // loop; a loop's parent is whoever owned its header just before it
+    std::vector<uint32_t> order(loops.size());
+    for (uint32_t l = 0; l < loops.size(); l++) order[l] = l;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return loops[a].blocks.size() > loops[b].blocks.size(); });
+    std::vector<uint32_t> owner(blockCount, Cfg::NONE);
+    for (uint32_t l : order) {
+        loops[l].parent = owner[loops[l].header];
+        for (uint32_t b : loops[l].blocks) owner[b] = l;
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const Loop& loop = loops[*it];
+        if (loop.parent != Cfg::NONE) loops[loop.parent].height = std::max(loops[loop.parent].height, loop.height + 1);
+    }
+    return loops;
+}
+
+namespace {
+
+bool isJump(Opcode op) {
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::IfTrue;
+}
+
+// An instruction to add in front of instruction "before"
+struct Insertion {
+    uint32_t before;
+    Opcode op;
+    Operand dst, lhs, rhs;
+};
+
+// Rebuilds code without the instructions whose keep flag is clear and
+// with the insertions in place; insertions at one position keep their order
+void applyEdits(TacCode& code, const std::vector<bool>& keep, std::vector<Insertion>& insertions) {
+    std::stable_sort(insertions.begin(), insertions.end(),
+                     [](const Insertion& a, const Insertion& b) { return a.before < b.before; });
+    TacCode out;
+    size_t next = 0;
+    for (uint32_t i = 0; i <= code.size(); i++) {
+        for (; next < insertions.size() && insertions[next].before == i; next++) {
+            const Insertion& ins = insertions[next];
+            out.add(ins.op, ins.dst, ins.lhs, ins.rhs);
+        }
+        if (i < code.size() && keep[i]) out.add(code.ops[i], code.dst[i], code.lhs[i], code.rhs[i]);
+    }
+    code.ops = std::move(out.ops);
+    code.dst = std::move(out.dst);
+    code.lhs = std::move(out.lhs);
+    code.rhs = std::move(out.rhs);
+}
+
+// Everything a loop pass needs about the current code
+struct LoopContext {
+    Cfg cfg;
+    std::vector<Loop> loops;
+    std::vector<uint32_t> defCount, useCount; // per slot, whole program
+    uint32_t maxHeight = 0;
+
+    explicit LoopContext(const TacCode& code) : cfg(code) {
+        cfg.computeDominators();
+        loops = findLoops(cfg);
+        for (const Loop& loop : loops) maxHeight = std::max(maxHeight, loop.height);
+        defCount.assign(code.vars.size() + code.tempTypes.size(), 0);
+        useCount.assign(defCount.size(), 0);
+        for (size_t i = 0; i < code.size(); i++) {
+            uint32_t d = slotOf(code, code.dst[i]);
+            if (d != Cfg::NONE) defCount[d]++;
+            for (Operand operand : {code.lhs[i], code.rhs[i]}) {
+                uint32_t u = slotOf(code, operand);
+                if (u != Cfg::NONE) useCount[u]++;
+            }
+        }
+    }
+
+    // Where preheader code can go: in front of the header's label, if the
+    // loop is only entered by falling into that label from the block above
+    uint32_t preheader(const TacCode& code, const Loop& loop) const {
+        uint32_t h = loop.header;
+        const BasicBlock& header = cfg.blocks[h];
+        if (header.begin == header.end || code.ops[header.begin] != Opcode::Label) return Cfg::NONE;
+        bool entered = false;
+        for (uint32_t p : header.preds) {
+            if (std::binary_search(loop.blocks.begin(), loop.blocks.end(), p)) continue;
+            if (p != h - 1) return Cfg::NONE;
+            const BasicBlock& above = cfg.blocks[p];
+            // A jump from the block above into the header would skip the preheader
+            if (above.end > above.begin && isJump(code.ops[above.end - 1]) &&
+                code.dst[above.end - 1] == code.dst[header.begin]) return Cfg::NONE;
+            entered = true;
+        }
+        return entered ? header.begin : Cfg::NONE;
+    }
+};
+
+bool integerConstant(const TacCode& code, const Interner& interner, Operand operand, int64_t& value) {
+    if (operand.kind() != OperandKind::Const || code.consts[operand.index()].type != Type::Integer) return false;
+    std::string_view text = interner.name(code.consts[operand.index()].text);
+    return std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc();
+}
+
+} // namespace
+
+// Division is the one operation that can fault
+bool safeToSpeculate(const TacCode& code, const Interner& interner, size_t i) {
+    if (code.ops[i] != Opcode::Div) return true;
+    if (code.typeOf(code.dst[i]) == Type::Decimal) return true;
+    int64_t divisor;
+    return integerConstant(code, interner, code.rhs[i], divisor) && divisor != 0 && divisor != -1;
+}
+
+bool hoistLoopInvariants(TacCode& code, const Interner& interner) {
+    bool changed = false;
+    for (uint32_t height = 0;; height++) {
+        LoopContext context(code);
+        if (height > context.maxHeight || context.loops.empty()) break;
+        const Cfg& cfg = context.cfg;
+        Liveness live = computeLiveness(code, cfg);
+
+        std::vector<bool> keep(code.size(), true);
+        std::vector<Insertion> insertions;
+        std::vector<uint32_t> definedIn(context.defCount.size(), Cfg::NONE); // slot -> loop writing it
+        for (uint32_t l = 0; l < context.loops.size(); l++) {
+            const Loop& loop = context.loops[l];
+            uint32_t position = context.preheader(code, loop);
+            if (loop.height != height || position == Cfg::NONE) continue;
+
+            for (uint32_t b : loop.blocks) {
+                for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+                    uint32_t d = slotOf(code, code.dst[i]);
+                    if (d != Cfg::NONE) definedIn[d] = l;
+                }
+            }
+            auto invariant = [&](Operand operand) {
+                uint32_t s = slotOf(code, operand);
+                return s == Cfg::NONE || definedIn[s] != l;
+            };
+
+            // Hoisting one instruction can make later ones invariant
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (uint32_t b : loop.blocks) {
+                    for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+                        Opcode op = code.ops[i];
+                        Operand d = code.dst[i];
+                        if (!keep[i] || (op != Opcode::Assign && !isBinary(op)) || d.kind() != OperandKind::Temp) continue;
+                        uint32_t s = slotOf(code, d);
+                        if (context.defCount[s] != 1 || live.isLiveIn(loop.header, s)) continue;
+                        if (!invariant(code.lhs[i]) || !invariant(code.rhs[i]) || !safeToSpeculate(code, interner, i)) continue;
+                        insertions.push_back(Insertion{position, op, d, code.lhs[i], code.rhs[i]});
+                        keep[i] = false;
+                        definedIn[s] = Cfg::NONE;
+                        moved = changed = true;
+                    }
+                }
+            }
+        }
+        if (!insertions.empty()) applyEdits(code, keep, insertions);
+    }
+    return changed;
+}
+
+bool reduceStrength(TacCode& code, Interner& interner) {
+    bool changed = false;
+    for (uint32_t height = 0;; height++) {
+        LoopContext context(code);
+        if (height > context.maxHeight || context.loops.empty()) break;
+        const Cfg& cfg = context.cfg;
+
+        std::vector<bool> keep(code.size(), true);
+        std::vector<Insertion> insertions;
+        std::vector<uint32_t> definedIn(context.defCount.size(), Cfg::NONE), defsInLoop(context.defCount.size(), 0);
+        std::vector<uint32_t> defAt(context.defCount.size(), Cfg::NONE);
+        for (uint32_t l = 0; l < context.loops.size(); l++) {
+            const Loop& loop = context.loops[l];
+            uint32_t position = context.preheader(code, loop);
+            if (loop.height != height || position == Cfg::NONE) continue;
+
+            for (uint32_t b : loop.blocks) {
+                for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+                    uint32_t d = slotOf(code, code.dst[i]);
+                    if (d == Cfg::NONE) continue;
+                    if (definedIn[d] != l) {
+                        definedIn[d] = l;
+                        defsInLoop[d] = 0;
+                    }
+                    defsInLoop[d]++;
+                    defAt[d] = i;
+                }
+            }
+
+            // i + c, c + i or i - c for an integer constant c
+            auto stepOf = [&](size_t j, Operand iv, int64_t& step) {
+                Opcode op = code.ops[j];
+                if (op == Opcode::Add && code.lhs[j] == iv && integerConstant(code, interner, code.rhs[j], step)) return true;
+                if (op == Opcode::Add && code.rhs[j] == iv && integerConstant(code, interner, code.lhs[j], step)) return true;
+                if (op == Opcode::Sub && code.lhs[j] == iv && integerConstant(code, interner, code.rhs[j], step)) {
+                    step = int64_t(0 - uint64_t(step));
+                    return true;
+                }
+                return false;
+            };
+            // A basic induction variable is written once in the loop, either
+            // as i = i + c or as t = i + c; i = t
+            auto induction = [&](Operand iv, int64_t& step, uint32_t& update) {
+                uint32_t s = slotOf(code, iv);
+                if (s == Cfg::NONE || definedIn[s] != l || defsInLoop[s] != 1 || code.typeOf(iv) != Type::Integer) return false;
+                update = defAt[s];
+                if (stepOf(update, iv, step)) return true;
+                if (code.ops[update] != Opcode::Assign || code.lhs[update].kind() != OperandKind::Temp) return false;
+                uint32_t t = slotOf(code, code.lhs[update]);
+                return definedIn[t] == l && context.defCount[t] == 1 && stepOf(defAt[t], iv, step);
+            };
+
+            std::map<std::pair<uint32_t, int64_t>, Operand> running; // (iv, factor) -> s
+            for (uint32_t b : loop.blocks) {
+                for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+                    if (code.ops[i] != Opcode::Mul || code.typeOf(code.dst[i]) != Type::Integer) continue;
+                    Operand iv = code.lhs[i], factorOperand = code.rhs[i];
+                    int64_t factor, step;
+                    uint32_t update;
+                    if (!integerConstant(code, interner, factorOperand, factor)) std::swap(iv, factorOperand);
+                    if (!integerConstant(code, interner, factorOperand, factor) || !induction(iv, step, update)) continue;
+
+                    auto key = std::make_pair(iv.bits, factor);
+                    auto found = running.find(key);
+                    if (found == running.end()) {
+                        Operand s = code.newTemp(Type::Integer);
+                        std::string increment = std::to_string(int64_t(uint64_t(step) * uint64_t(factor)));
+                        insertions.push_back(Insertion{position, Opcode::Mul, s, iv, factorOperand});
+                        insertions.push_back(Insertion{update + 1, Opcode::Add, s, s,
+                                                       code.constant(interner.intern(increment), Type::Integer)});
+                        found = running.emplace(key, s).first;
+                    }
+                    changed = true;
+
+                    // A product read once further down the block, before i
+                    // changes, can read s directly
+                    uint32_t t = slotOf(code, code.dst[i]);
+                    uint32_t j = i + 1;
+                    while (j < cfg.blocks[b].end && j != update && code.lhs[j] != code.dst[i] && code.rhs[j] != code.dst[i]) j++;
+                    if (code.dst[i].kind() == OperandKind::Temp && context.defCount[t] == 1 && context.useCount[t] == 1 &&
+                        j < cfg.blocks[b].end && j != update) {
+                        if (code.lhs[j] == code.dst[i]) code.lhs[j] = found->second;
+                        if (code.rhs[j] == code.dst[i]) code.rhs[j] = found->second;
+                        keep[i] = false;
+                        continue;
+                    }
+                    code.ops[i] = Opcode::Assign;
+                    code.lhs[i] = found->second;
+                    code.rhs[i] = Operand();
+                }
+            }
+        }
+        if (!insertions.empty()) applyEdits(code, keep, insertions);
+    }
+    return changed;
+}
+
+bool rotateLoops(TacCode& code) {
+    if (code.size() == 0) return false;
+    LoopContext context(code);
+    const Cfg& cfg = context.cfg;
+    std::vector<bool> keep(code.size(), true);
+    std::vector<Insertion> insertions;
+
+    for (const Loop& loop : context.loops) {
+        // Header: label, condition, conditional exit; body falls out of it
+        uint32_t h = loop.header;
+        const BasicBlock& header = cfg.blocks[h];
+        if (loop.latches.size() != 1 || loop.latches[0] == h || h + 1 >= cfg.blocks.size()) continue;
+        if (code.ops[header.begin] != Opcode::Label) continue;
+        Opcode exit = code.ops[header.end - 1];
+        if (exit != Opcode::IfFalse && exit != Opcode::IfTrue) continue;
+        auto inLoop = [&](uint32_t b) { return std::binary_search(loop.blocks.begin(), loop.blocks.end(), b); };
+        if (inLoop(cfg.labelBlock[code.dst[header.end - 1].index()]) || !inLoop(h + 1)) continue;
+
+        const BasicBlock& latch = cfg.blocks[loop.latches[0]];
+        uint32_t back = latch.end - 1;
+        if (code.ops[back] != Opcode::Goto || code.dst[back] != code.dst[header.begin]) continue;
+
+        Operand top = code.newLabel();
+        insertions.push_back(Insertion{cfg.blocks[h + 1].begin, Opcode::Label, top, Operand(), Operand()});
+        for (uint32_t i = header.begin + 1; i + 1 < header.end; i++) {
+            insertions.push_back(Insertion{back, code.ops[i], code.dst[i], code.lhs[i], code.rhs[i]});
+        }
+        Opcode stay = exit == Opcode::IfFalse ? Opcode::IfTrue : Opcode::IfFalse;
+        insertions.push_back(Insertion{back, stay, top, code.lhs[header.end - 1], Operand()});
+        keep[back] = false;
+    }
+    if (insertions.empty()) return false;
+    applyEdits(code, keep, insertions);
+    return true;
+}
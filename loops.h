@@ -0,0 +1,42 @@
+// loops.h
+#pragma once
+#include "cfg.h"
+#include "interner.h"
+#include "tac.h"
+#include <cstdint>
+#include <vector>
+
+struct Loop {
+    uint32_t header;
+    std::vector<uint32_t> latches; // blocks with a back edge to the header
+    std::vector<uint32_t> blocks;  // body in block order, header included
+    uint32_t parent = Cfg::NONE;   // innermost enclosing loop
+    uint32_t height = 0;           // 0 for loops with no inner loop
+};
+
+// Natural loops of the back edges (edges into a dominator), one per
+// header. cfg must have dominators computed.
+std::vector<Loop> findLoops(const Cfg& cfg);
+
+// Whether instruction i may run where it would not have, or be dropped
+// when its result is unused: false for an integer division unless the
+// divisor is a known constant other than 0 and -1.
+bool safeToSpeculate(const TacCode& code, const Interner& interner, size_t i);
+
+// Loop passes. They work innermost loops first, so code hoisted out of an
+// inner loop can move on out of the enclosing one. Each returns true if it
+// changed the code.
+
+// Moves pure computations whose operands do not change in the loop to a
+// preheader in front of the loop header.
+bool hoistLoopInvariants(TacCode& code, const Interner& interner);
+
+// For a basic induction variable i (its only definition in the loop is
+// i = i +/- c), replaces t = i * k by a running temp s kept equal to i * k:
+// s = i * k before the loop and s = s + c * k after each update of i.
+bool reduceStrength(TacCode& code, Interner& interner);
+
+// Moves the exit test of loops whose condition is a single block to the
+// bottom: the header stays as a guard and the back edge becomes a copy of
+// the test jumping to the top of the body, saving a jump per iteration.
+bool rotateLoops(TacCode& code);
@@ -0,0 +1,160 @@
+// machine_ir.cpp
+#include "machine_ir.h"
+
+Cond invert(Cond cc) {
+    return Cond(uint8_t(cc) ^ 1); // condition codes come in negated pairs
+}
+
+const char* regName(Reg reg, int bytes) {
+    static const char* const xmmNames[16] = {"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+                                             "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"};
+    if (isXmm(reg)) return xmmNames[uint8_t(reg) & 15];
+    static const char* const names[4][16] = {
+        {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil", "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+        {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di", "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+        {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+        {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+    };
+    int row = bytes == 1 ? 0 : bytes == 2 ? 1 : bytes == 4 ? 2 : 3;
+    return names[row][uint8_t(reg)];
+}
+
+const char* condName(Cond cc) {
+    static const char* const names[16] = {"o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"};
+    return names[uint8_t(cc)];
+}
+
+namespace {
+
+const char* mnemonic(MOp op) {
+    switch (op) {
+    case MOp::Mov: return "mov";
+    case MOp::Movzx: return "movzx";
+    case MOp::Lea: return "lea";
+    case MOp::Add: return "add";
+    case MOp::Sub: return "sub";
+    case MOp::Imul: case MOp::Imul3: return "imul";
+    case MOp::And: return "and";
+    case MOp::Or: return "or";
+    case MOp::Xor: return "xor";
+    case MOp::Shl: return "shl";
+    case MOp::Sar: return "sar";
+    case MOp::Cqo: return "cqo";
+    case MOp::Idiv: return "idiv";
+    case MOp::Cmp: return "cmp";
+    case MOp::Test: return "test";
+    case MOp::Jmp: return "jmp";
+    case MOp::Call: return "call";
+    case MOp::Push: return "push";
+    case MOp::Pop: return "pop";
+    case MOp::Movsd: return "movsd";
+    case MOp::Addsd: return "addsd";
+    case MOp::Subsd: return "subsd";
+    case MOp::Mulsd: return "mulsd";
+    case MOp::Divsd: return "divsd";
+    case MOp::Ucomisd: return "ucomisd";
+    case MOp::Cvtsi2sd: return "cvtsi2sd";
+    case MOp::Cvttsd2si: return "cvttsd2si";
+    case MOp::Xorpd: return "xorpd";
+    case MOp::Leave: return "leave";
+    case MOp::Ret: return "ret";
+    default: return "";
+    }
+}
+
+class Printer {
+    const MachineCode& code;
+    std::ostream& out;
+
+    void operand(const MOperand& o, bool sized) {
+        switch (o.kind) {
+        case MOperandKind::Reg: out << regName(o.reg, o.bytes); break;
+        case MOperandKind::Imm: out << o.value; break;
+        case MOperandKind::Stack: out << (sized ? "qword ptr " : "") << "[rbp - " << o.value << "]"; break;
+        case MOperandKind::Symbol: out << (sized ? "qword ptr " : "") << "[rip + " << code.symbols[o.value].name << "]"; break;
+        case MOperandKind::Label: out << ".L" << o.value; break;
+        default: break;
+        }
+    }
+
+    void data(const MachineCode::Symbol& symbol) {
+        if (symbol.align > 1) out << ".balign " << symbol.align << "\n";
+        out << symbol.name << ":\n";
+        const std::string& bytes = symbol.bytes;
+        bool text = !bytes.empty() && bytes.back() == '\0';
+        for (size_t i = 0; text && i + 1 < bytes.size(); i++) text = bytes[i] != '\0';
+        if (text) {
+            out << "    .asciz \"";
+            for (size_t i = 0; i + 1 < bytes.size(); i++) {
+                unsigned char ch = static_cast<unsigned char>(bytes[i]);
+                if (ch == '"' || ch == '\\') out << '\\' << ch;
+                else if (ch >= 0x20 && ch < 0x7f) out << ch;
+                else out << '\\' << char('0' + (ch >> 6)) << char('0' + ((ch >> 3) & 7)) << char('0' + (ch & 7));
+            }
+            out << "\"\n";
+            return;
+        }
+        out << "    .byte ";
+        for (size_t i = 0; i < bytes.size(); i++) out << (i ? ", " : "") << int(static_cast<unsigned char>(bytes[i]));
+        out << "\n";
+    }
+
+public:
+    Printer(const MachineCode& code, std::ostream& out) : code(code), out(out) {}
+
+    void run() {
+        out << ".intel_syntax noprefix\n";
+        for (const auto& symbol : code.symbols) {
+            if (symbol.external) out << ".extern " << symbol.name << "\n";
+        }
+        out << ".text\n.globl " << code.entry << "\n" << code.entry << ":\n";
+        for (const MInst& inst : code.insts) {
+            switch (inst.op) {
+            case MOp::Label:
+                out << ".L" << inst.a.value << ":\n";
+                continue;
+            case MOp::Setcc:
+                out << "    set" << condName(inst.cc) << " ";
+                operand(inst.a, false);
+                break;
+            case MOp::Jcc:
+                out << "    j" << condName(inst.cc) << " ";
+                operand(inst.a, false);
+                break;
+            case MOp::Call:
+                out << "    call " << code.symbols[inst.a.value].name;
+                break;
+            default: {
+                out << "    " << mnemonic(inst.op);
+                // Memory operands need an explicit size unless a register
+                // fixes it; cvtsi2sd's integer source can be either width
+                bool sized = inst.op == MOp::Cvtsi2sd || (inst.op != MOp::Lea && !inst.a.isReg() && !inst.b.isReg());
+                const MOperand* operands[3] = {&inst.a, &inst.b, &inst.c};
+                for (int k = 0; k < 3 && operands[k]->kind != MOperandKind::None; k++) {
+                    out << (k ? ", " : " ");
+                    operand(*operands[k], sized);
+                }
+                break;
+            }
+            }
+            out << "\n";
+        }
+
+        for (bool readOnly : {true, false}) {
+            bool header = false;
+            for (const auto& symbol : code.symbols) {
+                if (symbol.external || symbol.readOnly != readOnly) continue;
+                if (!header) out << (readOnly ? ".section .rodata\n" : ".data\n");
+                header = true;
+                data(symbol);
+            }
+        }
+        out << ".section .note.GNU-stack,\"\",@progbits\n"; // no executable stack
+    }
+};
+
+} // namespace
+
+void MachineCode::print(std::ostream& out) const {
+    Printer(*this, out).run();
+}
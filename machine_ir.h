@@ -0,0 +1,120 @@
+// machine_ir.h
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// x86-64 general-purpose registers, then the SSE registers, each in
+// encoding order (the low four bits)
+enum class Reg : uint8_t {
+    rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+    r8, r9, r10, r11, r12, r13, r14, r15,
+    xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+    xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15
+};
+
+inline bool isXmm(Reg reg) {
+    return uint8_t(reg) >= uint8_t(Reg::xmm0);
+}
+
+// Condition codes in encoding order (the low nibble of jcc/setcc)
+enum class Cond : uint8_t {
+    o, no, b, ae, e, ne, be, a, s, ns, p, np, l, ge, le, g
+};
+
+Cond invert(Cond cc);
+const char* regName(Reg reg, int bytes = 8);
+const char* condName(Cond cc);
+
+enum class MOperandKind : uint8_t {
+    None,
+    Reg,
+    Imm,    // 64-bit immediate
+    Stack,  // qword [rbp - disp]
+    Symbol, // qword [rip + symbol], or the address itself for lea
+    Label   // jump target
+};
+
+struct MOperand {
+    MOperandKind kind = MOperandKind::None;
+    Reg reg = Reg::rax;
+    uint8_t bytes = 8;  // register width for Reg operands
+    int64_t value = 0;  // Imm value, Stack displacement, Symbol/Label index
+
+    static MOperand r(Reg reg, int bytes = 8) { MOperand o; o.kind = MOperandKind::Reg; o.reg = reg; o.bytes = uint8_t(bytes); return o; }
+    static MOperand imm(int64_t v) { MOperand o; o.kind = MOperandKind::Imm; o.value = v; return o; }
+    static MOperand stack(int64_t disp) { MOperand o; o.kind = MOperandKind::Stack; o.value = disp; return o; }
+    static MOperand symbol(uint32_t index) { MOperand o; o.kind = MOperandKind::Symbol; o.value = index; return o; }
+    static MOperand label(uint32_t index) { MOperand o; o.kind = MOperandKind::Label; o.value = index; return o; }
+
+    bool isReg() const { return kind == MOperandKind::Reg; }
+    bool isReg(Reg r) const { return kind == MOperandKind::Reg && reg == r; }
+    bool isImm() const { return kind == MOperandKind::Imm; }
+    bool isMem() const { return kind == MOperandKind::Stack || kind == MOperandKind::Symbol; }
+    bool fitsImm32() const { return isImm() && value == int64_t(int32_t(value)); }
+    bool operator==(const MOperand& o) const {
+        return kind == o.kind && value == o.value && (kind != MOperandKind::Reg || (reg == o.reg && bytes == o.bytes));
+    }
+    bool operator!=(const MOperand& o) const { return !(*this == o); }
+};
+
+enum class MOp : uint8_t {
+    Label,  // a:
+    Mov,    // a = b
+    Movzx,  // a = zero-extended byte b
+    Lea,    // a = address of b
+    Add, Sub, Imul, And, Or, Xor,
+    Imul3,  // a = b * c (c immediate)
+    Shl, Sar, // a <<= b, a >>= b (b immediate)
+    Cqo,    // rdx:rax = sign-extended rax
+    Idiv,   // rax, rdx = rdx:rax / a, rdx:rax % a
+    Cmp, Test,
+    Setcc,  // a = cc ? 1 : 0 (byte register)
+    Jmp, Jcc,
+    // Scalar double (decimal) operations on SSE registers
+    Movsd,             // a = b, either side memory
+    Addsd, Subsd, Mulsd, Divsd,
+    Ucomisd,           // flags from a ? b; unordered sets ZF, PF and CF
+    Cvtsi2sd,          // a = double(b), b a 64-bit integer
+    Cvttsd2si,         // a = b truncated to a 64-bit integer
+    Xorpd,             // xorpd a, a zeroes a
+    Call,   // call symbol a
+    Push, Pop,
+    Leave, Ret
+};
+
+constexpr size_t MOP_COUNT = size_t(MOp::Ret) + 1;
+
+struct MInst {
+    MOp op;
+    Cond cc = Cond::e;
+    MOperand a, b, c;
+};
+
+// A function's worth of machine code plus the symbols it refers to.
+// Symbols are either data (string literals, decimal constants) or
+// external helpers called by the code.
+struct MachineCode {
+    struct Symbol {
+        std::string name;
+        std::string bytes; // contents for data symbols
+        bool external = false;
+        bool readOnly = true;
+        uint32_t align = 1;
+    };
+
+    std::vector<MInst> insts;
+    std::vector<Symbol> symbols;
+    std::string entry = "main";
+
+    void add(MOp op, MOperand a = MOperand(), MOperand b = MOperand(), MOperand c = MOperand()) {
+        insts.push_back(MInst{op, Cond::e, a, b, c});
+    }
+    void add(MOp op, Cond cc, MOperand a = MOperand()) {
+        insts.push_back(MInst{op, cc, a, MOperand(), MOperand()});
+    }
+
+    // GNU as source in Intel syntax
+    void print(std::ostream& out) const;
+};
@@ -1,37 +1,406 @@
+#include "assemblycode_generator.h"
+#include "cfg.h"
+#include "compile_cache.h"
+#include "dataflow.h"
+#include "driver.h"
+#include "jit.h"
 #include "lexer.h"
-#include "parser.h"
+#include "parallel_lexer.h"
+#include "runtime_output.h"
+#include "server.h"
+#include "source_buffer.h"
+#include "ssa.h"
+#include "tac_file.h"
+#include "vm.h"
+#include "x86_encoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <sstream>
+
+namespace {
+
+enum class Run { None, Jit, Vm, VmSwitch, BenchVm, BenchAnalysis };
 
-int main() {
-    std::ifstream file("input.custom");
-    if (!file.is_open()) {
-        std::cerr << "Failed to open input.custom" << std::endl;
+std::string milliseconds(std::chrono::steady_clock::duration elapsed) {
+    char ms[32];
+    std::snprintf(ms, sizeof(ms), "%.3f", std::chrono::duration<double, std::milli>(elapsed).count());
+    return ms;
+}
+
+// Best of a few runs of each dispatch loop, with the output discarded
+void benchmarkVm(const Bytecode& bytecode) {
+    std::chrono::steady_clock::duration best[2] = {std::chrono::steady_clock::duration::max(),
+                                                   std::chrono::steady_clock::duration::max()};
+    std::string error;
+    discardOutput(true);
+    for (int round = 0; round < 5; round++) {
+        for (Dispatch dispatch : {Dispatch::Threaded, Dispatch::Switch}) {
+            auto begin = std::chrono::steady_clock::now();
+            runBytecode(bytecode, dispatch, error);
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            auto& slot = best[dispatch == Dispatch::Threaded ? 0 : 1];
+            if (elapsed < slot) slot = elapsed;
+        }
+    }
+    discardOutput(false);
+    char speedup[32];
+    std::snprintf(speedup, sizeof(speedup), "%.2f", double(best[1].count()) / double(std::max<long long>(best[0].count(), 1)));
+    std::cout << "vm: " << bytecode.insts.size() << " instructions, threaded " << milliseconds(best[0])
+              << " ms, switch " << milliseconds(best[1]) << " ms (" << speedup << "x)" << std::endl;
+}
+
+// Best of a few runs of each analysis the optimizer builds on, each round
+// on a fresh copy of code
+void benchmarkAnalyses(const TacCode& code) {
+    using Clock = std::chrono::steady_clock;
+    Clock::duration best[4] = {Clock::duration::max(), Clock::duration::max(), Clock::duration::max(),
+                               Clock::duration::max()};
+    auto lap = [&](int slot, Clock::time_point& begin) {
+        Clock::time_point now = Clock::now();
+        best[slot] = std::min(best[slot], now - begin);
+        begin = now;
+    };
+    for (int round = 0; round < 3; round++) {
+        TacCode copy = code;
+        Clock::time_point begin = Clock::now();
+        Cfg cfg(copy);
+        cfg.computeDominators();
+        cfg.computeFrontiers();
+        lap(0, begin);
+        Liveness liveness = computeLiveness(copy, cfg);
+        lap(1, begin);
+        computeReachingDefinitions(copy, cfg, liveness);
+        lap(2, begin);
+        SsaForm ssa = buildSsa(copy, cfg);
+        destroySsa(copy, cfg, ssa);
+        lap(3, begin);
+    }
+    std::cout << "analysis: " << code.ops.size() << " instructions, cfg+dom+df " << milliseconds(best[0])
+              << " ms, liveness " << milliseconds(best[1]) << " ms, reaching " << milliseconds(best[2])
+              << " ms, ssa " << milliseconds(best[3]) << " ms" << std::endl;
+}
+
+// Runs code on the VM or in-process instead of writing output
+int execute(const TacCode& code, const Interner& interner, Run run, std::ostream* report,
+            std::chrono::steady_clock::time_point start) {
+    if (run == Run::Jit) {
+        MachineCode machine = generateAssembly(code, interner, report);
+        JitImage image;
+        if (!image.load(machine, encodeMachineCode(machine))) {
+            std::cerr << "Failed to load the program for execution" << std::endl;
+            return 1;
+        }
+        auto loaded = std::chrono::steady_clock::now();
+        int status = 0;
+        std::string error;
+        bool ok = image.run(status, error);
+        std::cerr << "jit: compile " << milliseconds(loaded - start) << " ms, run "
+                  << milliseconds(std::chrono::steady_clock::now() - loaded) << " ms" << std::endl;
+        if (!ok) {
+            std::cerr << "Runtime error: " << error << std::endl;
+            return 1;
+        }
+        return status;
+    }
+    if (run == Run::BenchAnalysis) {
+        benchmarkAnalyses(code);
+        return 0;
+    }
+    Bytecode bytecode = lowerToBytecode(code, interner);
+    if (run == Run::BenchVm) {
+        benchmarkVm(bytecode);
+        return 0;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+    std::string error;
+    bool ok = runBytecode(bytecode, run == Run::Vm ? Dispatch::Threaded : Dispatch::Switch, error);
+    std::cerr << "vm: compile " << milliseconds(loaded - start) << " ms, run "
+              << milliseconds(std::chrono::steady_clock::now() - loaded) << " ms" << std::endl;
+    if (!ok) {
+        std::cerr << "Runtime error: " << error << std::endl;
         return 1;
     }
+    return 0;
+}
+
+void printCacheStats(const CacheStats& s) {
+    uint64_t lookups = s.hits + s.misses;
+    char rate[32];
+    std::snprintf(rate, sizeof(rate), "%.1f", lookups ? 100.0 * double(s.hits) / double(lookups) : 0.0);
+    std::cout << "cache: " << s.hits << " hits, " << s.misses << " misses (" << rate << "% hit rate), "
+              << s.bytesSaved << " bytes saved; " << s.entries << " entries, " << s.bytes << " bytes" << std::endl;
+}
+
+// The command line
+struct Options {
+    std::vector<std::string> inputs;
+    std::string output; // -o: the output file, or a batch's output directory
+    Emit emit = Emit::Tac;
+    bool emitTac = false;
+    bool optReport = false;
+    Run run = Run::None;
+    int optLevel = 0;
+    std::string cacheDir;
+    uint64_t cacheMegabytes = 256;
+    bool cacheStats = false;
+    bool benchBatch = false;
+    unsigned threads = 0;
+    bool parallelLex = false;
+    bool checkLex = false;
+    size_t checkChunkBytes = 0;
+    bool benchLex = false;
+    std::string serveSocket;
+    std::string remoteSocket;
+    std::chrono::steady_clock::time_point start;
+};
+
+// False with a message on an unknown option
+bool parseOptions(int argc, char* argv[], Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--emit-tac") {
+            o.emitTac = true;  // also print the TAC listing
+        } else if (arg == "--emit=tac" || arg == "--emit=asm" || arg == "--emit=obj") {
+            o.emit = arg == "--emit=tac" ? Emit::Tac : arg == "--emit=asm" ? Emit::Asm : Emit::Obj;
+        } else if (arg == "--jit") {
+            o.run = Run::Jit;  // run in-process instead of writing output
+        } else if (arg == "--vm" || arg == "--vm=switch") {
+            o.run = arg == "--vm" ? Run::Vm : Run::VmSwitch;  // interpret bytecode instead
+        } else if (arg == "--bench-vm") {
+            o.run = Run::BenchVm;  // time both dispatch loops
+        } else if (arg == "--bench-analysis") {
+            o.run = Run::BenchAnalysis;  // time CFG, dataflow and SSA on the TAC
+        } else if (arg == "-o" && i + 1 < argc) {
+            o.output = argv[++i];
+        } else if (arg == "--opt-report") {
+            o.optReport = true;  // per-pass instruction counts
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            o.optLevel = arg[2] - '0';
+        } else if (arg == "--cache" || arg.rfind("--cache=", 0) == 0) {
+            o.cacheDir = arg == "--cache" ? CompileCache::defaultDirectory() : arg.substr(8);
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            o.cacheMegabytes = std::strtoull(arg.c_str() + 13, nullptr, 10);  // bound in MiB
+        } else if (arg == "--cache-stats") {
+            o.cacheStats = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            o.threads = unsigned(std::strtoul(argv[++i], nullptr, 10));  // batch threads, default one per core
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            o.threads = unsigned(std::strtoul(arg.c_str() + 2, nullptr, 10));
+        } else if (arg == "--bench-batch") {
+            o.benchBatch = true;  // time the batch on 1..N threads
+        } else if (arg == "--parallel-lex") {
+            o.parallelLex = true;  // lex a single source in chunks on -j threads
+        } else if (arg == "--check-lex" || arg.rfind("--check-lex=", 0) == 0) {
+            o.checkLex = true;  // compare the parallel lexer against the sequential one
+            if (arg.size() > 11) o.checkChunkBytes = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        } else if (arg == "--bench-lex") {
+            o.benchLex = true;  // time reading and lexing the source, mapped and through ifstream
+        } else if (arg == "--serve" || arg.rfind("--serve=", 0) == 0) {
+            o.serveSocket = arg == "--serve" ? defaultSocketPath() : arg.substr(8);  // compile server
+        } else if (arg == "--remote" || arg.rfind("--remote=", 0) == 0) {
+            o.remoteSocket = arg == "--remote" ? defaultSocketPath() : arg.substr(9);  // compile on a server
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        } else {
+            o.inputs.push_back(arg);
+        }
+    }
+    return true;
+}
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+int batchMode(const std::vector<std::string>& paths, const Options& o, const CompileCache* cache) {
+    if (o.run != Run::None || o.emitTac || o.optReport || o.checkLex || o.benchLex || !o.remoteSocket.empty()) {
+        std::cerr << "--jit, --vm, --emit-tac, --opt-report, --check-lex, --bench-lex and --remote take a single source"
+                  << std::endl;
+        return 1;
+    }
+    BatchOptions options;
+    options.emit = o.emit;
+    options.optLevel = o.optLevel;
+    options.outputDir = o.output;
+    options.threads = o.threads;
+    options.cache = cache;
+    if (o.benchBatch) {
+        benchmarkBatch(paths, options, std::cout);
+        return 0;
+    }
+    BatchResult result = compileBatch(paths, options, std::cerr);
+    std::cerr << "batch: " << paths.size() << " files, " << result.failed << " failed, " << result.threads
+              << " threads, " << milliseconds(std::chrono::steady_clock::now() - o.start) << " ms" << std::endl;
+    if (cache && o.cacheStats) printCacheStats(cache->stats());
+    return result.failed ? 1 : 0;
+}
 
-    // Step 1: Lexical Analysis
-    Lexer lexer(buffer.str());
-    std::vector<Token> tokens;
-    Token token;
-    do {
-        token = lexer.getNextToken();
-        tokens.push_back(token);
-    } while (token.type != TokenType::END_OF_FILE);
+int checkLexMode(std::string_view source, const Options& o) {
+    std::string result;
+    bool same = checkParallelLexer(source, o.threads, o.checkChunkBytes, result);
+    (same ? std::cout : std::cerr) << result << std::flush;
+    return same ? 0 : 1;
+}
 
-    // Step 2: Syntax + Semantic Analysis
-    try {
-        Parser parser(tokens);
-        parser.parse();
-        std::cout << "Parsing and semantic analysis successful!" << std::endl;
-    } catch (const std::runtime_error& e) {
-        std::cerr << "Error during parsing: " << e.what() << std::endl;
+// Best of a few runs of reading path and lexing it into a token list two
+// ways: through ifstream into a string with every lexeme copied out, as
+// before sources were mapped, and mapped with lexemes that point into it
+int benchLexMode(const std::string& path) {
+    auto copied = [&] {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string text = buffer.str();
+        Interner interner;
+        Lexer lexer(text, interner);
+        std::vector<std::pair<TokenType, std::string>> tokens;
+        for (Token t; (t = lexer.getNextToken()).type != TokenType::END_OF_FILE;) tokens.emplace_back(t.type, t.lexeme);
+        return tokens.size();
+    };
+    auto mapped = [&] {
+        SourceBuffer source;
+        source.open(path);
+        Interner interner;
+        Lexer lexer(source.view(), interner);
+        std::vector<Token> tokens;
+        for (Token t; (t = lexer.getNextToken()).type != TokenType::END_OF_FILE;) tokens.push_back(t);
+        return tokens.size();
+    };
+    SourceBuffer probe;
+    if (path == "-" || !probe.open(path)) {
+        std::cerr << "--bench-lex needs a source file" << std::endl;
         return 1;
     }
+    std::chrono::steady_clock::duration best[2] = {std::chrono::steady_clock::duration::max(),
+                                                   std::chrono::steady_clock::duration::max()};
+    size_t tokens = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int way = 0; way < 2; way++) {
+            auto begin = std::chrono::steady_clock::now();
+            tokens = way == 0 ? copied() : mapped();
+            best[way] = std::min(best[way], std::chrono::steady_clock::now() - begin);
+        }
+    }
+    char speedup[32];
+    std::snprintf(speedup, sizeof(speedup), "%.2f", double(best[0].count()) / double(std::max<long long>(best[1].count(), 1)));
+    std::cout << "lex: " << probe.view().size() << " bytes, " << tokens << " tokens, ifstream+copies "
+              << milliseconds(best[0]) << " ms, mapped " << milliseconds(best[1]) << " ms (" << speedup << "x)" << std::endl;
+    return 0;
+}
 
+// The server does the whole compile; only the output comes back
+int remoteMode(std::string_view source, const Options& o, const std::string& output) {
+    if (o.run != Run::None || o.emitTac || o.optReport) {
+        std::cerr << "--remote only writes output" << std::endl;
+        return 1;
+    }
+    CompileResult result;
+    std::string error;
+    if (!compileRemote(o.remoteSocket, source, CompileOptions{o.emit, o.optLevel}, result, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    for (const Diagnostic& d : result.diagnostics) std::cerr << d.message << std::endl;
+    if (!result.ok) return 1;
+    if (!writeFile(output, result.output)) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
     return 0;
 }
+
+// Compiles source to output, or runs it
+int singleFileMode(std::string_view source, const Options& o, const std::string& output, const CompileCache* cache) {
+    std::ostream* report = o.optReport ? &std::cout : nullptr;
+
+    // A hit skips the whole pipeline: the stored output is copied out, or
+    // for running, the stored TAC goes straight to the backend. Listings
+    // and reports need the pipeline, so they bypass the cache.
+    std::string entry;
+    if (cache && !o.emitTac && !o.optReport) {
+        entry = cache->entryPath(source, outputExtension(o.run != Run::None ? Emit::Tac : o.emit), o.optLevel);
+        // A stored TAC file that fails validation is a miss too
+        Interner interner;
+        TacCode code;
+        bool hit = cache->lookup(entry, [&](std::string_view stored) {
+            if (o.run == Run::None) return writeFile(output, stored);
+            TacFile file;
+            if (!file.openImage(stored)) return false;
+            file.load(code, interner);
+            return true;
+        });
+        if (hit) {
+            // Only sources that compiled have entries, so stdout is the same
+            // as for a miss
+            std::cout << "Parsing successful!\nParsing and semantic analysis successful!" << std::endl;
+            if (o.cacheStats) printCacheStats(cache->stats());
+            return o.run == Run::None ? 0 : execute(code, interner, o.run, report, o.start);
+        }
+    }
+
+    CompileOptions options;
+    options.emit = o.run != Run::None ? Emit::Tac : o.emit; // runs store TAC in the cache
+    options.optLevel = o.optLevel;
+    options.parallelLex = o.parallelLex;
+    options.lexThreads = o.threads;
+    options.report = report;
+    options.listing = o.emitTac ? &std::cout : nullptr;
+    options.keepCode = o.run != Run::None;
+    Compiler compiler;
+    CompileResult result = compiler.compile(source, options);
+    for (const Diagnostic& d : result.diagnostics) std::cerr << d.message << std::endl;
+    if (!result.ok) return 1;
+    std::cout << "Parsing successful!\nParsing and semantic analysis successful!" << std::endl;
+
+    if (o.run == Run::None && !writeFile(output, result.output)) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    if (!entry.empty()) cache->store(entry, [&](const std::string& temp) { return writeFile(temp, result.output); });
+    if (cache && o.cacheStats) printCacheStats(cache->stats());
+    return o.run == Run::None ? 0 : execute(result.code, compiler.names(), o.run, report, o.start);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options o;
+    o.start = std::chrono::steady_clock::now();
+    if (!parseOptions(argc, argv, o)) return 1;
+    if (!o.serveSocket.empty()) return serveCompiler(o.serveSocket, std::cerr) ? 0 : 1;
+
+    CompileCache cache;
+    if (o.cacheStats && o.cacheDir.empty()) o.cacheDir = CompileCache::defaultDirectory();
+    if (!o.cacheDir.empty() && !cache.open(o.cacheDir, o.cacheMegabytes << 20)) {
+        std::cerr << "Failed to open cache " << o.cacheDir << std::endl;
+        return 1;
+    }
+    const CompileCache* usedCache = o.cacheDir.empty() ? nullptr : &cache;
+    if (o.cacheStats && o.inputs.empty()) {
+        printCacheStats(cache.stats());
+        return 0;
+    }
+
+    // Several inputs, a directory or a response file make a batch
+    std::vector<std::string> paths;
+    std::string inputError;
+    if (!collectInputs(o.inputs, paths, inputError)) {
+        std::cerr << inputError << std::endl;
+        return 1;
+    }
+    if (o.benchBatch || paths.size() > 1 || paths != o.inputs) return batchMode(paths, o, usedCache);
+
+    // Source path defaults to input.custom; "-" reads from stdin
+    std::string path = paths.empty() ? "input.custom" : paths[0];
+    if (o.benchLex) return benchLexMode(path);
+    SourceBuffer source;
+    if (!source.open(path)) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return 1;
+    }
+    if (o.checkLex) return checkLexMode(source.view(), o);
+    std::string output = o.output.empty() ? std::string("output.") + outputExtension(o.emit) : o.output;
+    if (!o.remoteSocket.empty()) return remoteMode(source.view(), o, output);
+    return singleFileMode(source.view(), o, output, usedCache);
+}
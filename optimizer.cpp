@@ -0,0 +1,604 @@
+// optimizer.cpp
+#include "optimizer.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "loops.h"
+#include "ssa.h"
+#include <chrono>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Lattice value for one variable or temp
+struct Value {
+    enum Kind : uint8_t { Unknown, Constant, Varying } kind = Unknown;
+    bool decimal = false;
+    union {
+        int64_t i = 0;
+        double d;
+    };
+
+    double asDouble() const { return decimal ? d : double(i); }
+    bool operator==(const Value& o) const {
+        if (kind != o.kind) return false;
+        if (kind != Constant) return true;
+        return decimal == o.decimal && (decimal ? d == o.d : i == o.i);
+    }
+    bool operator!=(const Value& o) const { return !(*this == o); }
+};
+
+Value varying() {
+    Value v;
+    v.kind = Value::Varying;
+    return v;
+}
+
+Value meet(const Value& a, const Value& b) {
+    if (a.kind == Value::Unknown) return b;
+    if (b.kind == Value::Unknown) return a;
+    if (a == b) return a;
+    return varying();
+}
+
+class ConstantPropagation {
+    TacCode& code;
+    Interner& interner;
+    size_t varCount;
+
+    // Variables occupy slots [0, varCount), temps follow
+    long slot(Operand operand) const {
+        if (operand.kind() == OperandKind::Var) return long(operand.index());
+        if (operand.kind() == OperandKind::Temp) return long(varCount + operand.index());
+        return -1;
+    }
+
+    Value constValue(Operand operand) const {
+        const Constant& c = code.consts[operand.index()];
+        std::string_view text = interner.name(c.text);
+        Value v;
+        if (c.type == Type::Integer) {
+            if (std::from_chars(text.data(), text.data() + text.size(), v.i).ec != std::errc()) return varying();
+        } else if (c.type == Type::Decimal) {
+            v.decimal = true;
+            v.d = std::strtod(std::string(text).c_str(), nullptr);
+        } else {
+            return varying(); // strings are not folded
+        }
+        v.kind = Value::Constant;
+        return v;
+    }
+
+    Value valueOf(Operand operand, const std::vector<Value>& state) const {
+        if (operand.kind() == OperandKind::Const) return constValue(operand);
+        long s = slot(operand);
+        return s >= 0 ? state[s] : varying();
+    }
+
+    // Converts a value to the declared type of its destination
+    Value coerce(Value v, Type type) const {
+        if (v.kind != Value::Constant) return v;
+        if (type == Type::Decimal && !v.decimal) {
+            v.decimal = true;
+            v.d = double(v.i);
+        } else if (type != Type::Decimal && v.decimal) {
+            return varying();
+        }
+        return v;
+    }
+
+    Value fold(Opcode op, const Value& a, const Value& b) const {
+        if (a.kind == Value::Varying || b.kind == Value::Varying) return varying();
+        if (a.kind == Value::Unknown || b.kind == Value::Unknown) return Value();
+
+        Value r;
+        r.kind = Value::Constant;
+        if (isComparison(op)) {
+            bool result;
+            if (a.decimal || b.decimal) {
+                double x = a.asDouble(), y = b.asDouble();
+                result = op == Opcode::Lt ? x < y : op == Opcode::Gt ? x > y : op == Opcode::Le ? x <= y
+                       : op == Opcode::Ge ? x >= y : op == Opcode::Eq ? x == y : x != y;
+            } else {
+                int64_t x = a.i, y = b.i;
+                result = op == Opcode::Lt ? x < y : op == Opcode::Gt ? x > y : op == Opcode::Le ? x <= y
+                       : op == Opcode::Ge ? x >= y : op == Opcode::Eq ? x == y : x != y;
+            }
+            r.i = result;
+            return r;
+        }
+
+        if (a.decimal || b.decimal) {
+            double x = a.asDouble(), y = b.asDouble();
+            r.decimal = true;
+            switch (op) {
+            case Opcode::Add: r.d = x + y; break;
+            case Opcode::Sub: r.d = x - y; break;
+            case Opcode::Mul: r.d = x * y; break;
+            default:
+                if (y == 0.0) return varying(); // leave division by zero to run time
+                r.d = x / y;
+                break;
+            }
+            return r;
+        }
+
+        // Integer arithmetic wraps like the 64-bit machine code would.
+        // Division truncates toward zero, and dividing by -1 negates with
+        // wraparound, so INT64_MIN / -1 is INT64_MIN here, in the VM and
+        // in native code. Division by zero is a run-time error.
+        uint64_t x = uint64_t(a.i), y = uint64_t(b.i);
+        switch (op) {
+        case Opcode::Add: r.i = int64_t(x + y); break;
+        case Opcode::Sub: r.i = int64_t(x - y); break;
+        case Opcode::Mul: r.i = int64_t(x * y); break;
+        default:
+            if (b.i == 0) return varying(); // leave division by zero to run time
+            r.i = b.i == -1 ? int64_t(0 - x) : a.i / b.i;
+            break;
+        }
+        return r;
+    }
+
+    void transfer(size_t i, std::vector<Value>& state) const {
+        Opcode op = code.ops[i];
+        long s = slot(code.dst[i]);
+        if (s < 0) return;
+        Type type = code.typeOf(code.dst[i]);
+        if (op == Opcode::Assign) {
+            state[s] = coerce(valueOf(code.lhs[i], state), type);
+        } else if (isBinary(op)) {
+            state[s] = coerce(fold(op, valueOf(code.lhs[i], state), valueOf(code.rhs[i], state)), type);
+        }
+    }
+
+    Operand makeConstant(const Value& v) {
+        char text[64];
+        std::to_chars_result result;
+        if (v.decimal) {
+            result = std::to_chars(text, text + sizeof(text), v.d);
+            std::string spelling(text, result.ptr);
+            // Keep decimals recognizable as decimals in the listing
+            if (spelling.find_first_of(".en") == std::string::npos) spelling += ".0";
+            return code.constant(interner.intern(spelling), Type::Decimal);
+        }
+        result = std::to_chars(text, text + sizeof(text), v.i);
+        return code.constant(interner.intern(std::string_view(text, size_t(result.ptr - text))), Type::Integer);
+    }
+
+    // Replaces a use by its constant value, if known
+    bool substitute(Operand& operand, const std::vector<Value>& state) {
+        long s = slot(operand);
+        if (s < 0 || state[s].kind != Value::Constant) return false;
+        operand = makeConstant(state[s]);
+        return true;
+    }
+
+public:
+    ConstantPropagation(TacCode& code, Interner& interner)
+        : code(code), interner(interner), varCount(code.vars.size()) {}
+
+    bool run() {
+        Cfg cfg(code);
+        const std::vector<BasicBlock>& blocks = cfg.blocks;
+        Liveness live = computeLiveness(code, cfg);
+        size_t slots = varCount + code.tempTypes.size();
+
+        // Block entry states only hold the names live into the block, in
+        // the order of live.liveIn; everything else is written before it is
+        // read. One full-width state is loaded from them per block visit.
+        std::vector<std::vector<Value>> in(blocks.size());
+        for (size_t b = 0; b < blocks.size(); b++) in[b].resize(live.liveIn[b].size());
+        in[0].assign(in[0].size(), varying());
+        std::vector<Value> state(slots);
+        auto load = [&](uint32_t b) {
+            const std::vector<uint32_t>& names = live.liveIn[b];
+            for (size_t k = 0; k < names.size(); k++) state[live.globals[names[k]]] = in[b][k];
+        };
+
+        std::vector<bool> queued(blocks.size(), false);
+        std::vector<uint32_t> worklist;
+        for (size_t k = cfg.rpo.size(); k-- > 0;) {
+            worklist.push_back(cfg.rpo[k]);
+            queued[cfg.rpo[k]] = true;
+        }
+
+        while (!worklist.empty()) {
+            uint32_t b = worklist.back();
+            worklist.pop_back();
+            queued[b] = false;
+
+            load(b);
+            for (size_t i = blocks[b].begin; i < blocks[b].end; i++) transfer(i, state);
+
+            for (uint32_t succ : blocks[b].succs) {
+                bool changed = false;
+                const std::vector<uint32_t>& names = live.liveIn[succ];
+                for (size_t k = 0; k < names.size(); k++) {
+                    Value merged = meet(in[succ][k], state[live.globals[names[k]]]);
+                    if (merged != in[succ][k]) {
+                        in[succ][k] = merged;
+                        changed = true;
+                    }
+                }
+                if (changed && !queued[succ]) {
+                    queued[succ] = true;
+                    worklist.push_back(succ);
+                }
+            }
+        }
+
+        // Rewrite each block with the states that hold at its instructions
+        bool changed = false;
+        std::vector<bool> keep(code.size(), true);
+        for (uint32_t b = 0; b < blocks.size(); b++) {
+            load(b);
+            for (size_t i = blocks[b].begin; i < blocks[b].end; i++) {
+                Opcode op = code.ops[i];
+                if (op == Opcode::Assign || isBinary(op) || op == Opcode::IfFalse || op == Opcode::IfTrue || op == Opcode::Print) {
+                    changed |= substitute(code.lhs[i], state);
+                }
+                if (isBinary(op)) {
+                    changed |= substitute(code.rhs[i], state);
+                }
+
+                transfer(i, state);
+
+                if (isBinary(op)) {
+                    long s = slot(code.dst[i]);
+                    if (s >= 0 && state[s].kind == Value::Constant) {
+                        code.ops[i] = Opcode::Assign;
+                        code.lhs[i] = makeConstant(state[s]);
+                        code.rhs[i] = Operand();
+                        changed = true;
+                    }
+                } else if ((op == Opcode::IfFalse || op == Opcode::IfTrue) && code.lhs[i].kind() == OperandKind::Const) {
+                    Value cond = constValue(code.lhs[i]);
+                    if (cond.kind == Value::Constant) {
+                        bool truth = cond.decimal ? cond.d != 0.0 : cond.i != 0;
+                        bool taken = op == Opcode::IfFalse ? !truth : truth;
+                        if (taken) {
+                            code.ops[i] = Opcode::Goto;
+                            code.lhs[i] = Operand();
+                        } else {
+                            keep[i] = false;
+                        }
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        code.compact(keep);
+        return changed;
+    }
+};
+
+} // namespace
+
+bool propagateConstants(TacCode& code, Interner& interner) {
+    if (code.size() == 0) return false;
+    return ConstantPropagation(code, interner).run();
+}
+
+namespace {
+
+bool isJump(Opcode op) {
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::IfTrue;
+}
+
+std::vector<size_t> labelPositions(const TacCode& code) {
+    std::vector<size_t> pos(code.labelCount, SIZE_MAX);
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code.ops[i] == Opcode::Label) pos[code.dst[i].index()] = i;
+    }
+    return pos;
+}
+
+// Index of the first non-label instruction at or after i
+size_t skipLabels(const TacCode& code, size_t i) {
+    while (i < code.size() && code.ops[i] == Opcode::Label) i++;
+    return i;
+}
+
+// True if label is one of the labels in the run starting at i
+bool labelInRun(const TacCode& code, size_t i, Operand label) {
+    for (; i < code.size() && code.ops[i] == Opcode::Label; i++) {
+        if (code.dst[i] == label) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool threadJumps(TacCode& code) {
+    std::vector<size_t> pos = labelPositions(code);
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (!isJump(code.ops[i])) continue;
+        Operand target = code.dst[i];
+        // Follow goto chains; the hop limit stops on goto cycles
+        for (size_t hops = 0; hops < 64; hops++) {
+            size_t next = skipLabels(code, pos[target.index()]);
+            if (next >= code.size() || code.ops[next] != Opcode::Goto || code.dst[next] == target) break;
+            target = code.dst[next];
+        }
+        if (target != code.dst[i]) {
+            code.dst[i] = target;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool removeUnreachable(TacCode& code) {
+    if (code.size() == 0) return false;
+    Cfg cfg(code);
+    std::vector<bool> keep(code.size(), true);
+    bool changed = false;
+    for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+        if (cfg.reachable(b)) continue;
+        for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) keep[i] = false;
+        changed |= cfg.blocks[b].end > cfg.blocks[b].begin;
+    }
+    if (changed) code.compact(keep);
+    return changed;
+}
+
+bool removeJumpsToNext(TacCode& code) {
+    std::vector<bool> keep(code.size(), true);
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (!isJump(code.ops[i])) continue;
+
+        // "goto L; L:" and "ifFalse t goto L; L:" fall through anyway
+        if (labelInRun(code, i + 1, code.dst[i])) {
+            keep[i] = false;
+            changed = true;
+            continue;
+        }
+
+        // "ifFalse t goto A; goto B; A:" becomes "if t goto B; A:"
+        bool conditional = code.ops[i] == Opcode::IfFalse || code.ops[i] == Opcode::IfTrue;
+        if (conditional && i + 1 < code.size() && code.ops[i + 1] == Opcode::Goto && labelInRun(code, i + 2, code.dst[i])) {
+            code.ops[i] = code.ops[i] == Opcode::IfFalse ? Opcode::IfTrue : Opcode::IfFalse;
+            code.dst[i] = code.dst[i + 1];
+            keep[i + 1] = false;
+            i++;
+            changed = true;
+        }
+    }
+    if (changed) code.compact(keep);
+    return changed;
+}
+
+bool removeUnusedLabels(TacCode& code) {
+    std::vector<bool> used(code.labelCount, false);
+    for (size_t i = 0; i < code.size(); i++) {
+        if (isJump(code.ops[i])) used[code.dst[i].index()] = true;
+    }
+
+    std::vector<bool> keep(code.size(), true);
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code.ops[i] == Opcode::Label && !used[code.dst[i].index()]) {
+            keep[i] = false;
+            changed = true;
+        }
+    }
+    if (changed) code.compact(keep);
+    return changed;
+}
+
+bool removeDeadTemps(TacCode& code) {
+    // Count reads of each temp, then delete unread definitions; deleting one
+    // can make its operands dead in turn, so walk backwards
+    std::vector<uint32_t> uses(code.tempTypes.size(), 0);
+    auto countUse = [&](Operand operand, int delta) {
+        if (operand.kind() == OperandKind::Temp) uses[operand.index()] += delta;
+    };
+    for (size_t i = 0; i < code.size(); i++) {
+        countUse(code.lhs[i], 1);
+        countUse(code.rhs[i], 1);
+    }
+
+    std::vector<bool> keep(code.size(), true);
+    bool changed = false;
+    for (size_t i = code.size(); i-- > 0;) {
+        Opcode op = code.ops[i];
+        if ((op == Opcode::Assign || isBinary(op)) && code.dst[i].kind() == OperandKind::Temp && uses[code.dst[i].index()] == 0) {
+            keep[i] = false;
+            countUse(code.lhs[i], -1);
+            countUse(code.rhs[i], -1);
+            changed = true;
+        }
+    }
+    if (changed) code.compact(keep);
+    return changed;
+}
+
+namespace {
+
+// Copy propagation and dead definition removal on SSA form. With a single
+// definition per name, a copy "v = s" of the same type lets every use of v
+// read s directly, wherever it is. Only constants and temps that were
+// already single-definition are substituted, which keeps the form
+// conventional (see ssa.h).
+class SsaCleanup {
+    TacCode& code;
+    const Interner& interner;
+    SsaForm& ssa;
+    std::vector<Operand> alias;   // temp -> value it copies
+    std::vector<uint32_t> uses;   // reads by live instructions and phis
+    bool changed = false;
+
+    Operand resolve(Operand operand) {
+        Operand root = operand;
+        while (root.kind() == OperandKind::Temp && !alias[root.index()].isNone()) root = alias[root.index()];
+        // Point the whole chain at its root
+        while (operand != root && operand.kind() == OperandKind::Temp && !alias[operand.index()].isNone()) {
+            Operand next = alias[operand.index()];
+            alias[operand.index()] = root;
+            operand = next;
+        }
+        return root;
+    }
+
+    void countUse(Operand operand, int delta) {
+        if (operand.kind() == OperandKind::Temp) uses[operand.index()] += delta;
+    }
+
+    void countUses() {
+        uses.assign(code.tempTypes.size(), 0);
+        for (size_t i = 0; i < code.size(); i++) {
+            if (!ssa.keep[i]) continue;
+            countUse(code.lhs[i], 1);
+            countUse(code.rhs[i], 1);
+        }
+        for (const auto& phis : ssa.phis) {
+            for (const Phi& phi : phis) {
+                if (phi.dst.isNone()) continue;
+                for (Operand arg : phi.args) countUse(arg, 1);
+            }
+        }
+    }
+
+public:
+    SsaCleanup(TacCode& code, const Interner& interner, SsaForm& ssa) : code(code), interner(interner), ssa(ssa) {}
+
+    // "t = a op b; v = t" with no other reader of t becomes "v = a op b"
+    void foldCopies() {
+        countUses();
+        for (size_t i = 1; i < code.size(); i++) {
+            Operand d = code.dst[i], t = code.lhs[i];
+            if (code.ops[i] != Opcode::Assign || !ssa.isVersion(d) || t.kind() != OperandKind::Temp) continue;
+            if (code.dst[i - 1] != t || !ssa.keep[i - 1] || uses[t.index()] != 1) continue;
+            if (code.typeOf(t) != code.typeOf(d)) continue;
+            code.dst[i - 1] = d;
+            ssa.keep[i] = false;
+            changed = true;
+        }
+    }
+
+    void propagateCopies() {
+        alias.assign(code.tempTypes.size(), Operand());
+        for (size_t i = 0; i < code.size(); i++) {
+            Operand d = code.dst[i], s = code.lhs[i];
+            if (!ssa.keep[i] || code.ops[i] != Opcode::Assign || d.kind() != OperandKind::Temp) continue;
+            if (s.kind() != OperandKind::Const && (s.kind() != OperandKind::Temp || ssa.isVersion(s))) continue;
+            if (code.typeOf(s) != code.typeOf(d)) continue; // the copy converts
+            alias[d.index()] = s;
+            ssa.keep[i] = false;
+            changed = true;
+        }
+        for (size_t i = 0; i < code.size(); i++) {
+            code.lhs[i] = resolve(code.lhs[i]);
+            code.rhs[i] = resolve(code.rhs[i]);
+        }
+        for (auto& phis : ssa.phis) {
+            for (Phi& phi : phis) {
+                for (Operand& arg : phi.args) arg = resolve(arg);
+            }
+        }
+    }
+
+    void removeDeadDefinitions() {
+        countUses();
+        size_t temps = code.tempTypes.size();
+        std::vector<uint32_t> defInstr(temps, Cfg::NONE);
+        std::vector<std::pair<uint32_t, uint32_t>> defPhi(temps, {Cfg::NONE, 0});
+        for (uint32_t i = 0; i < code.size(); i++) {
+            Opcode op = code.ops[i];
+            // A division that may fault stays even if nothing reads it
+            if (ssa.keep[i] && (op == Opcode::Assign || isBinary(op)) && code.dst[i].kind() == OperandKind::Temp &&
+                safeToSpeculate(code, interner, i)) {
+                defInstr[code.dst[i].index()] = i;
+            }
+        }
+        for (uint32_t b = 0; b < ssa.phis.size(); b++) {
+            for (uint32_t k = 0; k < ssa.phis[b].size(); k++) {
+                if (!ssa.phis[b][k].dst.isNone()) defPhi[ssa.phis[b][k].dst.index()] = {b, k};
+            }
+        }
+
+        std::vector<uint32_t> worklist;
+        for (uint32_t t = 0; t < temps; t++) {
+            if (uses[t] == 0) worklist.push_back(t);
+        }
+        while (!worklist.empty()) {
+            uint32_t t = worklist.back();
+            worklist.pop_back();
+            std::vector<Operand> freed;
+            if (defInstr[t] != Cfg::NONE) {
+                uint32_t i = defInstr[t];
+                ssa.keep[i] = false;
+                defInstr[t] = Cfg::NONE;
+                freed = {code.lhs[i], code.rhs[i]};
+            } else if (defPhi[t].first != Cfg::NONE) {
+                Phi& phi = ssa.phis[defPhi[t].first][defPhi[t].second];
+                phi.dst = Operand();
+                defPhi[t].first = Cfg::NONE;
+                freed = phi.args;
+            } else {
+                continue;
+            }
+            changed = true;
+            for (Operand operand : freed) {
+                countUse(operand, -1);
+                if (operand.kind() == OperandKind::Temp && uses[operand.index()] == 0) worklist.push_back(operand.index());
+            }
+        }
+    }
+
+    bool result() const { return changed; }
+};
+
+} // namespace
+
+bool propagateCopies(TacCode& code, const Interner& interner) {
+    if (code.size() == 0) return false;
+    Cfg cfg(code);
+    cfg.computeDominators();
+    cfg.computeFrontiers();
+    SsaForm ssa = buildSsa(code, cfg);
+
+    SsaCleanup cleanup(code, interner, ssa);
+    cleanup.foldCopies();
+    cleanup.propagateCopies();
+    cleanup.removeDeadDefinitions();
+    destroySsa(code, cfg, ssa);
+    return cleanup.result();
+}
+
+void optimize(TacCode& code, Interner& interner, int level, std::ostream* report) {
+    if (level < 1) return;
+
+    auto run = [&](const char* name, auto pass) {
+        size_t before = code.size();
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (report) {
+            char ms[32];
+            std::snprintf(ms, sizeof(ms), "%.3f", elapsed.count());
+            *report << name << ": " << before << " -> " << code.size() << " instructions (" << ms << " ms)\n";
+        }
+    };
+
+    run("constant-propagation", [&] { propagateConstants(code, interner); });
+    if (level >= 2) {
+        run("ssa-copy-propagation", [&] { propagateCopies(code, interner); });
+        run("loop-invariant-motion", [&] { hoistLoopInvariants(code, interner); });
+        run("strength-reduction", [&] { reduceStrength(code, interner); });
+        run("loop-rotation", [&] { rotateLoops(code); });
+    }
+    run("jump-threading", [&] { threadJumps(code); });
+    run("unreachable-code", [&] { removeUnreachable(code); });
+    run("jumps-to-next", [&] { removeJumpsToNext(code); });
+    run("unused-labels", [&] { removeUnusedLabels(code); });
+    run("dead-temps", [&] { removeDeadTemps(code); });
+}
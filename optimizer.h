@@ -0,0 +1,29 @@
+// optimizer.h
+#pragma once
+#include "interner.h"
+#include "tac.h"
+#include <ostream>
+
+// Forward dataflow constant propagation over the basic blocks of code.
+// Uses of variables and temps with a known constant value are replaced by
+// the constant, binary operations on constants are folded (integer and
+// decimal arithmetic kept distinct), and ifFalse/if on a known condition
+// become a goto or disappear. Returns true if anything changed.
+bool propagateConstants(TacCode& code, Interner& interner);
+
+// Control-flow cleanup passes. Each returns true if it changed the code.
+bool threadJumps(TacCode& code);        // jump-to-jump chains go straight to the final target
+bool removeUnreachable(TacCode& code);  // blocks with no path from the entry
+bool removeJumpsToNext(TacCode& code);  // jumps to the next instruction, inverted branch-over-goto
+bool removeUnusedLabels(TacCode& code);
+bool removeDeadTemps(TacCode& code);    // temps that are computed but never read
+
+// Global copy propagation and dead definition removal, done by a round trip
+// through pruned SSA form. Also folds "t = a op b; v = t" into "v = a op b".
+// A division that may fault is kept even when its result is unused.
+bool propagateCopies(TacCode& code, const Interner& interner);
+
+// Runs the pass pipeline for an optimization level (-O2 adds the SSA and
+// loop passes from loops.h). When report is set, one line per pass with the instruction
+// count before and after and the time taken is written to it.
+void optimize(TacCode& code, Interner& interner, int level, std::ostream* report);
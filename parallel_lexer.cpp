@@ -0,0 +1,163 @@
+// parallel_lexer.cpp
+#include "parallel_lexer.h"
+#include "simd_scan.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// Below this a chunk costs more to schedule and merge than to lex
+constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+// Chunks per thread, so stealing can even out uneven chunks
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+Token TokenBuffer::next() {
+    while (chunk < chunks.size()) {
+        if (index < chunks[chunk].size()) return chunks[chunk][index++];
+        chunk++;
+        index = 0;
+    }
+    return end;
+}
+
+// Mirrors the lexer's handling of strings and comments, skipping from one
+// structural byte to the next
+std::vector<size_t> findSplitPoints(std::string_view source, size_t chunkBytes) {
+    // The lexer stops at an embedded '\0', so nothing after it is lexed
+    const char* p = source.data();
+    const void* nul = std::memchr(p, '\0', source.size());
+    size_t n = nul ? size_t(static_cast<const char*>(nul) - p) : source.size();
+
+    std::vector<size_t> splits;
+    size_t target = std::max<size_t>(chunkBytes, 1);
+    size_t depth = 0;
+    size_t pos = 0;
+    while (pos < n && (pos += scanForStructural(p + pos, n - pos)) < n) {
+        switch (p[pos]) {
+        case '"':
+            // An unterminated string runs to the end of input
+            pos++;
+            pos += scanForEither(p + pos, n - pos, '"', '"') + 1;
+            continue;
+        case '/':
+            if (pos + 1 < n && p[pos + 1] == '/') {
+                pos += 2 + scanForEither(p + pos + 2, n - pos - 2, '\n', '\n');
+            } else if (pos + 1 < n && p[pos + 1] == '*') {
+                for (pos += 2; (pos += scanForEither(p + pos, n - pos, '*', '*')) < n; pos++) {
+                    if (pos + 1 < n && p[pos + 1] == '/') break;
+                }
+                pos += 2; // past "*/", or past the end if unterminated
+            } else {
+                pos++;
+            }
+            continue;
+        case '{':
+            depth++;
+            pos++;
+            continue;
+        case '}':
+            // A stray '}' cannot take the depth below zero for the lexer either
+            if (depth > 0) depth--;
+            break;
+        default: // ';'
+            break;
+        }
+        pos++;
+        if (depth == 0 && pos >= target && pos < n) {
+            splits.push_back(pos);
+            target = pos + chunkBytes;
+        }
+    }
+    splits.push_back(n);
+    return splits;
+}
+
+TokenBuffer lexParallel(std::string_view source, Interner& interner, unsigned threads, size_t chunkBytes) {
+    WorkStealingPool pool(threads);
+    if (chunkBytes == 0) chunkBytes = std::max(MIN_CHUNK_BYTES, source.size() / (pool.size() * CHUNKS_PER_THREAD) + 1);
+    std::vector<size_t> splits = findSplitPoints(source, chunkBytes);
+
+    std::vector<std::vector<Token>> chunks(splits.size());
+    Token end;
+    std::vector<std::unique_ptr<Interner>> names(splits.size());
+    pool.run(splits.size(), [&](size_t i, unsigned) {
+        size_t begin = i == 0 ? 0 : splits[i - 1];
+        names[i].reset(new Interner);
+        Lexer lexer(source.substr(begin, splits[i] - begin), *names[i]);
+        std::vector<Token>& tokens = chunks[i];
+        for (Token token = lexer.getNextToken();; token = lexer.getNextToken()) {
+            if (token.type == TokenType::END_OF_FILE) {
+                if (i + 1 == splits.size()) end = token;
+                break;
+            }
+            tokens.push_back(token);
+        }
+    });
+
+    // Chunk order is first-occurrence order, so interning each chunk's
+    // names in id order reproduces the sequential ids exactly
+    std::vector<std::vector<SymbolId>> remap(splits.size());
+    for (size_t i = 0; i < splits.size(); i++) {
+        remap[i].resize(names[i]->size());
+        for (SymbolId id = 1; id < names[i]->size(); id++) remap[i][id] = interner.intern(names[i]->name(id));
+    }
+    pool.run(splits.size(), [&](size_t i, unsigned) {
+        for (Token& token : chunks[i]) token.id = remap[i][token.id];
+        names[i].reset();
+    });
+    return TokenBuffer(std::move(chunks), end);
+}
+
+bool checkParallelLexer(std::string_view source, unsigned threads, size_t chunkBytes, std::string& report) {
+    auto start = std::chrono::steady_clock::now();
+    Interner sequentialNames;
+    Lexer lexer(source, sequentialNames);
+    std::vector<Token> expected;
+    for (Token token = lexer.getNextToken();; token = lexer.getNextToken()) {
+        expected.push_back(token);
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+    double sequentialMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    Interner parallelNames;
+    TokenBuffer tokens = lexParallel(source, parallelNames, threads, chunkBytes);
+    double parallelMs = millisecondsSince(start);
+
+    char line[160];
+    for (size_t i = 0; i < expected.size(); i++) {
+        const Token& want = expected[i];
+        Token got = tokens.next();
+        if (got.type == want.type && got.lexeme.data() == want.lexeme.data() && got.lexeme.size() == want.lexeme.size() &&
+            got.id == want.id) {
+            continue;
+        }
+        size_t offset = size_t(want.lexeme.data() - source.data());
+        std::snprintf(line, sizeof(line), "lexer check: token %zu differs (near offset %zu): expected '%.*s' id %u, got '%.*s' id %u\n",
+                      i, offset, int(std::min<size_t>(want.lexeme.size(), 32)), want.lexeme.data(), want.id,
+                      int(std::min<size_t>(got.lexeme.size(), 32)), got.lexeme.data(), got.id);
+        report = line;
+        return false;
+    }
+    if (sequentialNames.size() != parallelNames.size()) {
+        std::snprintf(line, sizeof(line), "lexer check: %zu names interned, expected %zu\n", parallelNames.size(),
+                      sequentialNames.size());
+        report = line;
+        return false;
+    }
+    std::snprintf(line, sizeof(line), "lexer check: %zu tokens identical in %zu chunks; sequential %.1f ms, parallel %.1f ms\n",
+                  expected.size(), tokens.chunkCount(), sequentialMs, parallelMs);
+    report = line;
+    return true;
+}
@@ -0,0 +1,40 @@
+// parallel_lexer.h
+#pragma once
+#include "lexer.h"
+#include <string>
+#include <vector>
+
+// The tokens of a whole source, one buffer per chunk. Read in order they
+// are exactly the tokens the sequential Lexer produces, END_OF_FILE
+// included.
+class TokenBuffer {
+    std::vector<std::vector<Token>> chunks;
+    Token end;        // END_OF_FILE, positioned at the end of the source
+    size_t chunk = 0; // read position
+    size_t index = 0;
+
+public:
+    TokenBuffer() = default;
+    TokenBuffer(std::vector<std::vector<Token>> chunks, Token end) : chunks(std::move(chunks)), end(end) {}
+
+    Token next(); // END_OF_FILE once exhausted
+    size_t chunkCount() const { return chunks.size(); }
+};
+
+// Offsets just past a ';' or '}' at brace depth 0 outside strings and
+// comments, about every chunkBytes. Lexing restarted at such an offset
+// yields the same tokens as lexing straight through it. The last offset
+// is the end of the input: the buffer size or its first '\0'.
+std::vector<size_t> findSplitPoints(std::string_view source, size_t chunkBytes);
+
+// Lexes the chunks concurrently, each into its own token buffer against a
+// private interner, then interns the chunks' names into interner in chunk
+// order. That gives every name the id the sequential lexer would have
+// given it, so the result is indistinguishable from lexing in one pass.
+// chunkBytes 0 sizes the chunks from the source and thread count.
+TokenBuffer lexParallel(std::string_view source, Interner& interner, unsigned threads = 0, size_t chunkBytes = 0);
+
+// Differential check: lexes source sequentially and in parallel, each
+// with a fresh interner, and compares every token. On a mismatch report
+// says where; otherwise it has the token and chunk counts and timings.
+bool checkParallelLexer(std::string_view source, unsigned threads, size_t chunkBytes, std::string& report);
@@ -1,18 +1,15 @@
 // parser.cpp
 #include "parser.h"
-#include <iostream>
+#include <charconv>
 
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), current(0) {}
+Parser::Parser(TokenStream& tokens, Interner& interner, Ast& ast) : tokens(&tokens), interner(interner), ast(ast) {}
 
-Token Parser::peek() {
-    if (current < tokens.size()) 
-        return tokens[current];
-    return Token(TokenType::END_OF_FILE, "");
+const Token& Parser::peek() {
+    return tokens->peek();
 }
 
 Token Parser::advance() {
-    if (current < tokens.size()) current++;
-    return tokens[current - 1];
+    return tokens->next();
 }
 
 bool Parser::match(TokenType type) {
@@ -24,228 +21,367 @@ bool Parser::match(TokenType type) {
 }
 
 bool Parser::check(TokenType type) {
-    return current < tokens.size() && tokens[current].type == type;
+    return tokens->peek().type == type;
 }
 
 void Parser::error(const std::string& msg) {
-    std::cerr << "Syntax Error: " << msg << " at token: " << peek().lexeme << std::endl;
-    exit(1);
+    std::string_view token = peek().lexeme;
+    throw SyntaxError("Syntax Error: " + msg + " at token: " + std::string(token), token);
 }
 
-void Parser::parse() {
-    program();
-    std::cout << "Parsing successful!\n";
+NodeId Parser::parse() {
+    return program();
+}
 
-    // After parsing, print and write the intermediate code
-    icg.printCode();
-    icg.writeToFile("output.tac");
+NodeId Parser::program() {
+    return statementList(TokenType::END_OF_FILE);
 }
 
-void Parser::program() {
-    while (current < tokens.size() && peek().type != TokenType::END_OF_FILE) {
-        statement();
+// Parses statements up to (not including) the terminator into a Block node
+NodeId Parser::statementList(TokenType terminator) {
+    NodeId first = 0, last = 0;
+    while (!check(terminator)) {
+        if (peek().type == TokenType::END_OF_FILE) error("Expected } before end of input");
+        NodeId stmt = statement();
+        if (last) ast[last].next = stmt; else first = stmt;
+        last = stmt;
     }
+    return ast.add(NodeKind::Block, Type::None, 0, first);
 }
 
-void Parser::statement() {
+NodeId Parser::statement() {
     if (check(TokenType::INTEGER_TYPE) || check(TokenType::DECIMAL_TYPE) || check(TokenType::STRING_TYPE)) {
-        varDeclaration();
+        return varDeclaration();
     } else if (check(TokenType::IF)) {
-        ifStatement();
+        return ifStatement();
     } else if (check(TokenType::WHILE)) {
-        whileStatement();
+        return whileStatement();
     } else if (check(TokenType::FOR)) {
-        forStatement();
+        return forStatement();
     } else if (check(TokenType::PRINT)) {
-        printStatement();
+        return printStatement();
     } else if (check(TokenType::IDENTIFIER)) {
-        assignment();
+        return assignment();
     } else {
         error("Unexpected statement");
     }
+    return 0;
 }
 
-void Parser::varDeclaration() {
-    std::string type;
+Type Parser::declarationType() {
+    Type type = Type::None;
     if (check(TokenType::INTEGER_TYPE)) {
-        type = "integer";
-        advance();
+        type = Type::Integer;
     } else if (check(TokenType::DECIMAL_TYPE)) {
-        type = "decimal";
-        advance();
+        type = Type::Decimal;
     } else if (check(TokenType::STRING_TYPE)) {
-        type = "string";
-        advance();
+        type = Type::String;
     } else {
         error("Expected type");
     }
+    advance();
+    return type;
+}
+
+NodeId Parser::varDeclaration() {
+    NodeId decl = declaration();
+    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
+    return decl;
+}
+
+// Parses "<type> <identifier> === <expression>" and declares the variable
+NodeId Parser::declaration() {
+    Type type = declarationType();
 
     if (!check(TokenType::IDENTIFIER)) error("Expected identifier");
-    std::string varName = peek().lexeme;
-    advance();
+    Token name = advance();
 
     if (!match(TokenType::ASSIGN)) error("Expected ===");
 
-    if (!check(TokenType::NUMBER) && !check(TokenType::STRING_LITERAL)) error("Expected value");
-    std::string value = peek().lexeme;
-    TokenType valueType = peek().type;
-    advance();
+    NodeId value = expression();
+    Type valueType = ast[value].type;
 
-    if ((type == "integer" || type == "decimal") && valueType != TokenType::NUMBER) {
+    if ((type == Type::Integer || type == Type::Decimal) && valueType == Type::String) {
         error("Type mismatch: Expected number");
-    } else if (type == "string" && valueType != TokenType::STRING_LITERAL) {
+    } else if (type == Type::String && valueType != Type::String) {
         error("Type mismatch: Expected string literal");
     }
 
-    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
+    if (symTable.declaredInCurrentScope(name.id)) error("Variable '" + std::string(name.lexeme) + "' already declared");
+    VarId var = declareVariable(name, type);
+
+    return ast.add(NodeKind::VarDecl, type, name.id, value, 0, 0, var);
+}
 
-    if (symTable.exists(varName)) error("Variable '" + varName + "' already declared");
-    symTable.insert(varName, type);
+VarId Parser::declareVariable(const Token& name, Type type) {
+    if (declarationCount.size() <= name.id) declarationCount.resize(name.id + 1, 0);
+    uint32_t previous = declarationCount[name.id]++;
+    SymbolId irName = previous == 0 ? name.id
+        : interner.intern(std::string(name.lexeme) + "." + std::to_string(previous));
 
-    icg.emit(varName, value, "=");
+    VarId var = static_cast<VarId>(ast.vars.size());
+    ast.vars.push_back(VarInfo{name.id, irName, type});
+    symTable.insert(name.id, type, var);
+    return var;
 }
 
-void Parser::assignment() {
-    std::string varName;
+const Symbol& Parser::resolve(const Token& name) {
+    const Symbol* sym = symTable.lookup(name.id);
+    if (!sym) error("Undeclared variable: " + std::string(name.lexeme));
+    return *sym;
+}
 
-    if (check(TokenType::IDENTIFIER)) {
-        varName = peek().lexeme;
-        if (!symTable.exists(varName)) error("Undeclared variable: " + varName);
-        advance();
-    } else {
-        error("Expected variable name");
-    }
+// Parses "=== <expression>" for an already-consumed variable name
+NodeId Parser::assignTo(const Token& name) {
+    const Symbol sym = resolve(name);
 
     if (!match(TokenType::ASSIGN)) error("Expected ===");
 
-    std::string assignedType, value;
-    if (check(TokenType::NUMBER)) {
-        value = peek().lexeme;
-        assignedType = (value.find('.') != std::string::npos) ? "decimal" : "integer";
-        advance();
-    } else if (check(TokenType::STRING_LITERAL)) {
-        value = peek().lexeme;
-        assignedType = "string";
-        advance();
-    } else {
-        error("Unsupported assignment type");
-    }
+    NodeId value = expression();
+    Type assignedType = ast[value].type;
 
-    std::string declaredType = symTable.getType(varName);
+    Type declaredType = sym.type;
     if (declaredType != assignedType) {
-        error("Type mismatch in assignment to '" + varName + "': expected " + declaredType + ", got " + assignedType);
+        error("Type mismatch in assignment to '" + std::string(name.lexeme) + "': expected " + typeName(declaredType) + ", got " + typeName(assignedType));
     }
 
-    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
+    return ast.add(NodeKind::Assign, declaredType, name.id, value, 0, 0, sym.var);
+}
+
+NodeId Parser::assignment() {
+    if (!check(TokenType::IDENTIFIER)) error("Expected variable name");
+    Token name = advance();
+
+    NodeId assign = assignTo(name);
 
-    icg.emit(varName, value, "=");
+    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
+    return assign;
 }
 
-void Parser::ifStatement() {
+NodeId Parser::ifStatement() {
     advance(); // consume 'if'
 
-    if (!check(TokenType::QUOTED_CONDITION) && !check(TokenType::STRING_LITERAL))
-        error("Expected string condition");
-
-    std::string cond = peek().lexeme;
-    advance();
+    NodeId cond = condition("if");
+    NodeId thenBlock = block();
+    NodeId elseBlock = match(TokenType::ELSE) ? block() : 0;
 
-    std::string trueLabel = icg.newLabel();
-    std::string falseLabel = icg.newLabel();
-    std::string endLabel = icg.newLabel();
+    return ast.add(NodeKind::If, Type::None, 0, cond, thenBlock, elseBlock);
+}
 
-    std::string condTemp = icg.generateIfCondition(cond);
-    icg.emit("ifFalse", condTemp, "goto", falseLabel);
-    icg.emit("goto", trueLabel);
+NodeId Parser::whileStatement() {
+    advance(); // consume 'while'
 
-    icg.emitLabel(trueLabel);
-    block();
+    NodeId cond = condition("while");
+    NodeId body = block(); // the body of the while loop
 
-    if (match(TokenType::ELSE)) {
-        icg.emit("goto", endLabel);
-        icg.emitLabel(falseLabel);
-        block();
-        icg.emitLabel(endLabel);
-    } else {
-        icg.emitLabel(falseLabel);
-    }
+    return ast.add(NodeKind::While, Type::None, 0, cond, body);
 }
 
-void Parser::whileStatement() {
-    advance(); // consume 'while'
+
+NodeId Parser::forStatement() {
+    advance(); // consume 'for'
 
     if (!check(TokenType::QUOTED_CONDITION) && !check(TokenType::STRING_LITERAL))
-        error("Expected string condition");
+        error("Expected for condition in string");
 
-    std::string cond = peek().lexeme;
-    advance();
+    // The header "<init>, <condition>, <update>" is lexed as its own token
+    // stream; a variable declared by the init is scoped to the loop
+    Token header = advance();
+    symTable.enterScope();
+    Lexer headerLexer(header.lexeme, interner);
+    TokenStream headerTokens(headerLexer);
+    TokenStream* outer = tokens;
+    tokens = &headerTokens;
+
+    // Init: "integer i === 0" declares the variable, "i === 0" reuses one
+    NodeId init;
+    if (check(TokenType::INTEGER_TYPE) || check(TokenType::DECIMAL_TYPE) || check(TokenType::STRING_TYPE)) {
+        init = declaration();
+    } else {
+        if (!check(TokenType::IDENTIFIER)) error("Expected for-loop initializer");
+        init = assignTo(advance());
+    }
+    if (!match(TokenType::COMMA)) error("Expected , after for-loop initializer");
+
+    NodeId cond = truthValue(orExpression(), "for");
+    if (!match(TokenType::COMMA)) error("Expected , after for-loop condition");
+
+    // Update: "i++", "i--" or "i === <expression>"
+    if (!check(TokenType::IDENTIFIER)) error("Expected for-loop update");
+    Token var = advance();
+    NodeId update;
+    if (check(TokenType::OPERATOR) && (peek().lexeme == "++" || peek().lexeme == "--")) {
+        const Symbol sym = resolve(var);
+        Token op = advance();
+        NodeId lhs = ast.add(NodeKind::Variable, sym.type, var.id, 0, 0, 0, sym.var);
+        NodeId rhs = ast.add(NodeKind::Literal, Type::Integer, interner.intern("1"));
+        Token arith(TokenType::OPERATOR, op.lexeme.substr(0, 1));
+        update = ast.add(NodeKind::Assign, sym.type, var.id, binary(arith, lhs, rhs), 0, 0, sym.var);
+    } else {
+        update = assignTo(var);
+    }
+    if (!check(TokenType::END_OF_FILE)) error("Unexpected token in for-loop header");
+    tokens = outer;
+
+    NodeId body = block();
+    symTable.exitScope();
 
-    std::string startLabel = icg.newLabel();
-    std::string endLabel = icg.newLabel();
+    return ast.add(NodeKind::For, Type::None, 0, init, cond, update, body);
+}
 
-    icg.generateWhileStart(startLabel);
-    icg.generateWhileCondition(cond, startLabel, endLabel);
+NodeId Parser::block() {
+    if (!match(TokenType::LBRACE)) error("Expected {");
 
-    block(); // the body of the while loop
+    symTable.enterScope();
+    NodeId body = statementList(TokenType::RBRACE);
+    symTable.exitScope();
 
-    icg.emit("goto", startLabel);  // jump back to condition
-    icg.emitLabel(endLabel);       // loop end
+    if (!match(TokenType::RBRACE)) error("Expected }");
+    return body;
 }
 
+NodeId Parser::printStatement() {
+    advance(); // consume 'print'
 
-void Parser::forStatement() {
-    advance(); // consume 'for'
+    if (!check(TokenType::STRING_LITERAL) && !check(TokenType::IDENTIFIER))
+        error("Expected string literal or variable");
 
-    if (!check(TokenType::QUOTED_CONDITION) && !check(TokenType::STRING_LITERAL))
-        error("Expected for condition in string");
+    Token toPrint = advance();
+    NodeId operand;
+    if (toPrint.type == TokenType::STRING_LITERAL) {
+        operand = ast.add(NodeKind::Literal, Type::String, toPrint.id);
+    } else {
+        const Symbol& sym = resolve(toPrint);
+        operand = ast.add(NodeKind::Variable, sym.type, toPrint.id, 0, 0, 0, sym.var);
+    }
 
-    std::string cond = peek().lexeme;
-    advance();
+    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
 
-    // For simplicity: assume for-loop cond is like "x = 0; x < 10; x = x + 1"
-    // Parse init, condition, increment manually or assume separate statements. 
-    // Here we just emit condition checks and loop structure for demo:
+    return ast.add(NodeKind::Print, Type::None, 0, operand);
+}
 
-    std::string startLabel = icg.newLabel();
-    std::string endLabel = icg.newLabel();
+// Quoted conditions are lexed and parsed as a nested token stream
+NodeId Parser::condition(std::string_view keyword) {
+    if (!check(TokenType::QUOTED_CONDITION) && !check(TokenType::STRING_LITERAL))
+        error("Expected string condition");
 
-    icg.emitLabel(startLabel);
-    std::string condTemp = icg.generateIfCondition(cond);
-    icg.emit("ifFalse", condTemp, "goto", endLabel);
+    Token quoted = advance();
+    Lexer condLexer(quoted.lexeme, interner);
+    TokenStream condTokens(condLexer);
+    TokenStream* outer = tokens;
+    tokens = &condTokens;
 
-    block();
+    NodeId cond = truthValue(orExpression(), keyword);
+    if (!check(TokenType::END_OF_FILE)) error("Unexpected token in condition");
 
-    // Increment statement should be parsed from cond ideally, here omitted for brevity
-    icg.emit("goto", startLabel);
-    icg.emitLabel(endLabel);
+    tokens = outer;
+    return cond;
 }
 
-void Parser::block() {
-    if (!match(TokenType::LBRACE)) error("Expected {");
+// Conditions are tested against zero, as && and || test their operands
+NodeId Parser::truthValue(NodeId cond, std::string_view keyword) {
+    if (ast[cond].type == Type::String) error("Type mismatch: string operand to " + std::string(keyword));
+    return cond;
+}
 
-    while (!check(TokenType::RBRACE)) {
-        if (peek().type == TokenType::END_OF_FILE) error("Expected } before end of input");
-        statement();
+NodeId Parser::orExpression() {
+    NodeId lhs = andExpression();
+    while (check(TokenType::OPERATOR) && peek().lexeme == "||") {
+        Token op = advance();
+        lhs = binary(op, lhs, andExpression());
     }
+    return lhs;
+}
 
-    if (!match(TokenType::RBRACE)) error("Expected }");
+NodeId Parser::andExpression() {
+    NodeId lhs = relation();
+    while (check(TokenType::OPERATOR) && peek().lexeme == "&&") {
+        Token op = advance();
+        lhs = binary(op, lhs, relation());
+    }
+    return lhs;
 }
 
-void Parser::printStatement() {
-    advance(); // consume 'print'
+NodeId Parser::relation() {
+    NodeId lhs = expression();
+    if (check(TokenType::OPERATOR)) {
+        std::string_view op = peek().lexeme;
+        if (op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=") {
+            Token opToken = advance();
+            return binary(opToken, lhs, expression());
+        }
+    }
+    return lhs;
+}
 
-    if (!check(TokenType::STRING_LITERAL) && !check(TokenType::IDENTIFIER))
-        error("Expected string literal or variable");
-    
-    std::string toPrint = peek().lexeme;
-    advance();
+NodeId Parser::expression() {
+    NodeId lhs = term();
+    while (check(TokenType::OPERATOR) && (peek().lexeme == "+" || peek().lexeme == "-")) {
+        Token op = advance();
+        lhs = binary(op, lhs, term());
+    }
+    return lhs;
+}
 
-    if (!match(TokenType::SEMICOLON)) error("Expected semicolon");
+NodeId Parser::term() {
+    NodeId lhs = factor();
+    while (check(TokenType::OPERATOR) && (peek().lexeme == "*" || peek().lexeme == "/")) {
+        Token op = advance();
+        lhs = binary(op, lhs, factor());
+    }
+    return lhs;
+}
 
-    // Emit print statement intermediate code as: print toPrint
-    icg.emit("print", toPrint);
+NodeId Parser::factor() {
+    if (check(TokenType::NUMBER)) {
+        std::string_view text = peek().lexeme;
+        Type type = text.find('.') != std::string_view::npos ? Type::Decimal : Type::Integer;
+        // Every later stage takes integer literals to fit in 64 bits
+        int64_t value;
+        if (type == Type::Integer && std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc()) {
+            error("Integer literal out of range");
+        }
+        Token number = advance();
+        return ast.add(NodeKind::Literal, type, number.id);
+    }
+    if (check(TokenType::STRING_LITERAL)) {
+        Token literal = advance();
+        return ast.add(NodeKind::Literal, Type::String, literal.id);
+    }
+    if (check(TokenType::IDENTIFIER)) {
+        Token name = advance();
+        const Symbol& sym = resolve(name);
+        return ast.add(NodeKind::Variable, sym.type, name.id, 0, 0, 0, sym.var);
+    }
+    if (match(TokenType::LPAREN)) {
+        NodeId inner = orExpression();
+        if (!match(TokenType::RPAREN)) error("Expected )");
+        return inner;
+    }
+    error("Expected value");
+    return 0;
 }
 
-IntermediateCodeGenerator& Parser::getICG() {
-    return icg;
+// Builds a typed binary node, rejecting operand types the operator can't take
+NodeId Parser::binary(const Token& op, NodeId lhs, NodeId rhs) {
+    Type lt = ast[lhs].type;
+    Type rt = ast[rhs].type;
+    std::string_view spelling = op.lexeme;
+
+    if (spelling == "&&" || spelling == "||") {
+        if (lt == Type::String || rt == Type::String) error("Type mismatch: string operand to " + std::string(spelling));
+        return ast.add(spelling == "&&" ? NodeKind::And : NodeKind::Or, Type::Integer, 0, lhs, rhs);
+    }
+
+    if (spelling == "==" || spelling == "!=") {
+        if ((lt == Type::String) != (rt == Type::String))
+            error("Type mismatch: cannot compare " + std::string(typeName(lt)) + " with " + typeName(rt));
+    } else if (lt == Type::String || rt == Type::String) {
+        error("Type mismatch: string operand to " + std::string(spelling));
+    }
+
+    bool comparison = spelling == "<" || spelling == ">" || spelling == "<=" || spelling == ">=" || spelling == "==" || spelling == "!=";
+    Type type = comparison ? Type::Integer : (lt == Type::Decimal || rt == Type::Decimal ? Type::Decimal : Type::Integer);
+    return ast.add(NodeKind::Binary, type, interner.intern(spelling), lhs, rhs);
 }
+
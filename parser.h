@@ -1,37 +1,62 @@
 // parser.h
 #pragma once
 #include "lexer.h"
+#include "token_stream.h"
 #include "symbol_table.h"
-#include "intermediate_code_generator.h"
+#include "ast.h"
+#include <stdexcept>
 
+// The first syntax or semantic error ends the parse; what() is the
+// complete diagnostic
+struct SyntaxError : std::runtime_error {
+    std::string_view token; // the offending lexeme, a view into the source
 
+    SyntaxError(const std::string& message, std::string_view token) : std::runtime_error(message), token(token) {}
+};
 
 class Parser {
-    std::vector<Token> tokens;
-    size_t current = 0;
+    TokenStream* tokens; // switched to a nested stream inside quoted conditions
+    Interner& interner;
+    Ast& ast;
 
-    Token peek();
+    const Token& peek();
     Token advance();
     SymbolTable symTable;
-    IntermediateCodeGenerator icg;
+    std::vector<uint32_t> declarationCount; // per name, for IR spellings
     bool match(TokenType type);
     bool check(TokenType type);
-    void error(const std::string& msg);
+    [[noreturn]] void error(const std::string& msg);
 
 public:
-    Parser(const std::vector<Token>& tokens);
-    void parse(); // Entry point
-
-    IntermediateCodeGenerator& getICG();
+    Parser(TokenStream& tokens, Interner& interner, Ast& ast);
+    NodeId parse(); // Entry point, returns the program's Block node
 
 private:
-    void program();
-    void statement();
-    void varDeclaration();
-    void ifStatement();
-    void whileStatement();
-    void forStatement();
-    void assignment();
-    void block();
-    void printStatement();
+    NodeId program();
+    NodeId statement();
+    NodeId varDeclaration();
+    NodeId ifStatement();
+    NodeId whileStatement();
+    NodeId forStatement();
+    NodeId assignment();
+    NodeId block();
+    NodeId printStatement();
+
+    // Expressions, lowest precedence first
+    NodeId condition(std::string_view keyword);
+    NodeId truthValue(NodeId cond, std::string_view keyword);
+    NodeId orExpression();
+    NodeId andExpression();
+    NodeId relation();
+    NodeId expression();
+    NodeId term();
+    NodeId factor();
+    NodeId binary(const Token& op, NodeId lhs, NodeId rhs);
+
+    Type declarationType();
+    VarId declareVariable(const Token& name, Type type);
+    const Symbol& resolve(const Token& name);
+    NodeId declaration();
+    NodeId assignTo(const Token& name);
+    NodeId statementList(TokenType terminator);
 };
@@ -0,0 +1,335 @@
+// peephole.cpp
+#include "peephole.h"
+#include <algorithm>
+
+namespace {
+
+constexpr uint64_t ALWAYS_LIVE = regBit(Reg::rsp) | regBit(Reg::rbp);
+constexpr uint64_t CALLER_SAVED = regBit(Reg::rax) | regBit(Reg::rcx) | regBit(Reg::rdx) | regBit(Reg::rsi) |
+                                  regBit(Reg::rdi) | regBit(Reg::r8) | regBit(Reg::r9) | regBit(Reg::r10) |
+                                  regBit(Reg::r11) | (uint64_t(0xFFFF) << uint8_t(Reg::xmm0));
+constexpr uint64_t CALLEE_SAVED = regBit(Reg::rbx) | regBit(Reg::r12) | regBit(Reg::r13) | regBit(Reg::r14) |
+                                  regBit(Reg::r15);
+
+uint64_t bits(const MOperand& o) {
+    return o.isReg() ? regBit(o.reg) : 0; // memory operands only address through rbp and rip
+}
+
+// Locations an instruction writes and reads. Removable instructions have
+// no effect besides their definitions.
+struct Effect {
+    uint64_t defs = 0, uses = 0;
+    bool removable = false;
+};
+
+Effect effect(const MInst& inst) {
+    Effect e;
+    switch (inst.op) {
+    case MOp::Mov:
+    case MOp::Movzx:
+    case MOp::Lea:
+        e = {bits(inst.a), bits(inst.b), inst.a.isReg()};
+        break;
+    case MOp::Xor:
+        if (inst.a.isReg() && inst.a == inst.b) {
+            e = {bits(inst.a) | FLAGS, 0, true};
+            break;
+        }
+        [[fallthrough]];
+    case MOp::Add: case MOp::Sub: case MOp::Imul: case MOp::And: case MOp::Or: case MOp::Shl: case MOp::Sar:
+        e = {bits(inst.a) | FLAGS, bits(inst.a) | bits(inst.b), inst.a.isReg()};
+        break;
+    case MOp::Imul3:
+        e = {bits(inst.a) | FLAGS, bits(inst.b), inst.a.isReg()};
+        break;
+    case MOp::Cqo:
+        e = {regBit(Reg::rdx), regBit(Reg::rax), true};
+        break;
+    case MOp::Idiv: // may trap, so never removed
+        e = {regBit(Reg::rax) | regBit(Reg::rdx) | FLAGS, regBit(Reg::rax) | regBit(Reg::rdx) | bits(inst.a), false};
+        break;
+    case MOp::Cmp:
+    case MOp::Test:
+        e = {FLAGS, bits(inst.a) | bits(inst.b), true};
+        break;
+    case MOp::Setcc: // treated as a full write: the byte is always zero-extended before use
+        e = {bits(inst.a), FLAGS, true};
+        break;
+    case MOp::Jcc:
+        e.uses = FLAGS;
+        break;
+    case MOp::Movsd:
+    case MOp::Cvtsi2sd: // the upper half of the SSE register is never read
+    case MOp::Cvttsd2si:
+        e = {bits(inst.a), bits(inst.b), inst.a.isReg()};
+        break;
+    case MOp::Addsd: case MOp::Subsd: case MOp::Mulsd: case MOp::Divsd:
+        e = {bits(inst.a), bits(inst.a) | bits(inst.b), inst.a.isReg()};
+        break;
+    case MOp::Ucomisd:
+        e = {FLAGS, bits(inst.a) | bits(inst.b), true};
+        break;
+    case MOp::Xorpd:
+        e = {bits(inst.a), 0, true};
+        break;
+    case MOp::Call: // the runtime helpers take one argument, in rdi or xmm0
+        e = {CALLER_SAVED | FLAGS, regBit(Reg::rdi) | regBit(Reg::xmm0), false};
+        break;
+    case MOp::Push:
+        e.uses = bits(inst.a);
+        break;
+    case MOp::Pop:
+        e.defs = bits(inst.a);
+        break;
+    case MOp::Ret:
+        e.uses = regBit(Reg::rax) | CALLEE_SAVED;
+        break;
+    default:
+        break;
+    }
+    return e;
+}
+
+bool endsBlock(MOp op) {
+    return op == MOp::Jmp || op == MOp::Jcc || op == MOp::Ret;
+}
+
+// Locations live after each instruction, from a backward dataflow over
+// the blocks between labels and jumps
+std::vector<uint64_t> liveAfter(const std::vector<MInst>& insts) {
+    size_t n = insts.size();
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> blockOf(n);
+    std::vector<uint32_t> labelBlock;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || insts[i].op == MOp::Label || endsBlock(insts[i - 1].op)) starts.push_back(uint32_t(i));
+        blockOf[i] = uint32_t(starts.size() - 1);
+        if (insts[i].op == MOp::Label) {
+            size_t label = size_t(insts[i].a.value);
+            if (label >= labelBlock.size()) labelBlock.resize(label + 1, UINT32_MAX);
+            labelBlock[label] = blockOf[i];
+        }
+    }
+    size_t blocks = starts.size();
+    starts.push_back(uint32_t(n));
+
+    auto target = [&](const MInst& inst) {
+        size_t label = size_t(inst.a.value);
+        return label < labelBlock.size() ? labelBlock[label] : UINT32_MAX;
+    };
+
+    // in = gen | (out & ~kill) per block
+    std::vector<uint64_t> gen(blocks, 0), kill(blocks, 0), in(blocks, 0), out(blocks, 0);
+    for (size_t b = 0; b < blocks; b++) {
+        for (size_t i = starts[b + 1]; i-- > starts[b];) {
+            Effect e = effect(insts[i]);
+            gen[b] = e.uses | (gen[b] & ~e.defs);
+            kill[b] |= e.defs;
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks; b-- > 0;) {
+            const MInst& last = insts[starts[b + 1] - 1];
+            uint64_t live = 0;
+            if (last.op != MOp::Jmp && last.op != MOp::Ret && b + 1 < blocks) live |= in[b + 1];
+            if (last.op == MOp::Jmp || last.op == MOp::Jcc) {
+                uint32_t t = target(last);
+                if (t != UINT32_MAX) live |= in[t];
+            }
+            uint64_t newIn = gen[b] | (live & ~kill[b]);
+            out[b] = live;
+            if (newIn != in[b]) {
+                in[b] = newIn;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<uint64_t> after(n);
+    for (size_t b = 0; b < blocks; b++) {
+        uint64_t live = out[b] | ALWAYS_LIVE;
+        for (size_t i = starts[b + 1]; i-- > starts[b];) {
+            after[i] = live;
+            Effect e = effect(insts[i]);
+            live = (live & ~e.defs) | e.uses | ALWAYS_LIVE;
+        }
+    }
+    return after;
+}
+
+// Drops removable instructions whose definitions are all dead, walking
+// each block backward so chains of dead values go in one pass
+uint32_t removeDead(std::vector<MInst>& insts) {
+    std::vector<uint64_t> after = liveAfter(insts);
+    std::vector<bool> keep(insts.size(), true);
+    uint32_t removed = 0;
+    uint64_t live = 0;
+    for (size_t i = insts.size(); i-- > 0;) {
+        if (i + 1 == insts.size() || insts[i + 1].op == MOp::Label || endsBlock(insts[i].op)) live = after[i];
+        Effect e = effect(insts[i]);
+        if (e.removable && (e.defs & live) == 0) {
+            keep[i] = false;
+            removed++;
+            continue;
+        }
+        live = (live & ~e.defs) | e.uses | ALWAYS_LIVE;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < insts.size(); i++) {
+        if (keep[i]) insts[k++] = insts[i];
+    }
+    insts.resize(k);
+    return removed;
+}
+
+MInst inst(MOp op, MOperand a = MOperand(), MOperand b = MOperand(), MOperand c = MOperand()) {
+    return MInst{op, Cond::e, a, b, c};
+}
+
+MInst inst(MOp op, Cond cc, MOperand a) {
+    return MInst{op, cc, a, MOperand(), MOperand()};
+}
+
+bool isQword(const MOperand& o) {
+    return !o.isReg() || o.bytes == 8;
+}
+
+int powerOfTwo(const MOperand& o) {
+    if (!o.isImm() || o.value <= 0 || (o.value & (o.value - 1)) != 0) return -1;
+    int k = 0;
+    while ((int64_t(1) << k) != o.value) k++;
+    return k;
+}
+
+void multiplyByShift(MOperand dst, MOperand src, const MOperand& factor, std::vector<MInst>& out) {
+    if (src != dst) out.push_back(inst(MOp::Mov, dst, src));
+    int k = powerOfTwo(factor);
+    if (k > 0) out.push_back(inst(MOp::Shl, dst, MOperand::imm(k)));
+}
+
+// cmp a, b / setcc al / movzx eax, al / mov d, rax / cmp d, 0 / je L
+// becomes cmp a, b / ... / jNcc L; the materialized flag is then dead
+// unless d is read elsewhere
+bool matchBranchOnFlag(const PeepholeWindow& w) {
+    const MInst* in = w.insts;
+    return in[0].a.isReg() && in[0].a.bytes == 1 && in[1].a.isReg(in[0].a.reg) && in[1].b == in[0].a &&
+           in[2].b.isReg(in[0].a.reg) && in[2].b.bytes == 8 && in[3].a == in[2].a && in[3].b.isImm() &&
+           in[3].b.value == 0 && (in[4].cc == Cond::e || in[4].cc == Cond::ne) && w.dead(4, FLAGS);
+}
+
+void rewriteBranchOnFlag(const MInst* in, std::vector<MInst>& out) {
+    out.insert(out.end(), in, in + 3);
+    out.push_back(inst(MOp::Jcc, in[4].cc == Cond::ne ? in[0].cc : invert(in[0].cc), in[4].a));
+}
+
+const std::vector<PeepholeRule> RULES = {
+    {"branch-on-flag", {MOp::Setcc, MOp::Movzx, MOp::Mov, MOp::Cmp, MOp::Jcc}, matchBranchOnFlag, rewriteBranchOnFlag},
+    // jcc L1 / jmp L2 / L1:  ->  jNcc L2 / L1:
+    {"jump-over-jump", {MOp::Jcc, MOp::Jmp, MOp::Label},
+     [](const PeepholeWindow& w) { return w.insts[0].a == w.insts[2].a; },
+     [](const MInst* in, std::vector<MInst>& out) {
+         out.push_back(inst(MOp::Jcc, invert(in[0].cc), in[1].a));
+         out.push_back(in[2]);
+     }},
+    {"jump-to-next", {MOp::Jmp, MOp::Label},
+     [](const PeepholeWindow& w) { return w.insts[0].a == w.insts[1].a; },
+     [](const MInst* in, std::vector<MInst>& out) { out.push_back(in[1]); }},
+    {"self-move", {MOp::Mov},
+     [](const PeepholeWindow& w) { return w.insts[0].a == w.insts[0].b && isQword(w.insts[0].a); },
+     [](const MInst*, std::vector<MInst>&) {}},
+    // mov a, b / mov b, a: the second move changes nothing
+    {"move-back", {MOp::Mov, MOp::Mov},
+     [](const PeepholeWindow& w) {
+         const MInst* in = w.insts;
+         return in[1].a == in[0].b && in[1].b == in[0].a && isQword(in[0].a) && isQword(in[0].b);
+     },
+     [](const MInst* in, std::vector<MInst>& out) { out.push_back(in[0]); }},
+    // mov [s], r / mov r2, [s]: read the register instead of the slot
+    {"load-after-store", {MOp::Mov, MOp::Mov},
+     [](const PeepholeWindow& w) {
+         const MInst* in = w.insts;
+         return in[0].a.kind == MOperandKind::Stack && in[0].b.isReg() && in[0].b.bytes == 8 && in[1].b == in[0].a &&
+                in[1].a.isReg() && in[1].a.bytes == 8;
+     },
+     [](const MInst* in, std::vector<MInst>& out) {
+         out.push_back(in[0]);
+         if (in[1].a != in[0].b) out.push_back(inst(MOp::Mov, in[1].a, in[0].b));
+     }},
+    // mov r, 0  ->  xor r32, r32 (clobbers the flags, and zero-extends)
+    {"zero-idiom", {MOp::Mov},
+     [](const PeepholeWindow& w) {
+         const MInst& m = w.insts[0];
+         return m.a.isReg() && m.b.isImm() && m.b.value == 0 && w.dead(0, FLAGS);
+     },
+     [](const MInst* in, std::vector<MInst>& out) {
+         MOperand r = MOperand::r(in[0].a.reg, 4);
+         out.push_back(inst(MOp::Xor, r, r));
+     }},
+    {"compare-zero-to-test", {MOp::Cmp},
+     [](const PeepholeWindow& w) { return w.insts[0].a.isReg() && w.insts[0].b.isImm() && w.insts[0].b.value == 0; },
+     [](const MInst* in, std::vector<MInst>& out) { out.push_back(inst(MOp::Test, in[0].a, in[0].a)); }},
+    // imul d, s, 2^k  ->  mov d, s / shl d, k (the flags differ)
+    {"multiply-to-shift", {MOp::Imul3},
+     [](const PeepholeWindow& w) { return powerOfTwo(w.insts[0].c) >= 0 && w.dead(0, FLAGS); },
+     [](const MInst* in, std::vector<MInst>& out) { multiplyByShift(in[0].a, in[0].b, in[0].c, out); }},
+    {"multiply-in-place-to-shift", {MOp::Imul},
+     [](const PeepholeWindow& w) { return w.insts[0].a.isReg() && powerOfTwo(w.insts[0].b) >= 0 && w.dead(0, FLAGS); },
+     [](const MInst* in, std::vector<MInst>& out) { multiplyByShift(in[0].a, in[0].a, in[0].b, out); }},
+};
+
+} // namespace
+
+const std::vector<PeepholeRule>& peepholeRules() {
+    return RULES;
+}
+
+PeepholeStats runPeephole(MachineCode& code, const std::vector<PeepholeRule>& rules) {
+    PeepholeStats stats;
+    stats.applied.assign(rules.size(), 0);
+    stats.before = code.insts.size();
+
+    // Rules indexed by their first opcode
+    std::vector<std::vector<uint32_t>> byFirst(MOP_COUNT);
+    for (uint32_t r = 0; r < rules.size(); r++) byFirst[size_t(rules[r].ops[0])].push_back(r);
+
+    std::vector<MInst>& insts = code.insts;
+    for (int round = 0; round < 8; round++) {
+        std::vector<uint64_t> after = liveAfter(insts);
+        std::vector<MInst> next;
+        next.reserve(insts.size());
+        bool changed = false;
+        for (size_t i = 0; i < insts.size();) {
+            bool applied = false;
+            for (uint32_t r : byFirst[size_t(insts[i].op)]) {
+                const PeepholeRule& rule = rules[r];
+                size_t length = rule.ops.size();
+                if (i + length > insts.size()) continue;
+                bool same = true;
+                for (size_t k = 1; k < length && same; k++) same = insts[i + k].op == rule.ops[k];
+                if (!same || !rule.match(PeepholeWindow{&insts[i], &after[i]})) continue;
+                rule.rewrite(&insts[i], next);
+                stats.applied[r]++;
+                i += length;
+                applied = changed = true;
+                break;
+            }
+            if (!applied) next.push_back(insts[i++]);
+        }
+        insts.swap(next);
+        uint32_t removed = removeDead(insts);
+        stats.deadRemoved += removed;
+        if (!changed && !removed) break;
+    }
+    stats.after = insts.size();
+    return stats;
+}
+
+void printPeepholeReport(std::ostream& out, const std::vector<PeepholeRule>& rules, const PeepholeStats& stats) {
+    out << "peephole: " << stats.before << " -> " << stats.after << " instructions\n";
+    for (size_t r = 0; r < rules.size(); r++) {
+        if (stats.applied[r]) out << "  " << rules[r].name << ": " << stats.applied[r] << "\n";
+    }
+    if (stats.deadRemoved) out << "  dead instructions: " << stats.deadRemoved << "\n";
+}
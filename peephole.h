@@ -0,0 +1,42 @@
+// peephole.h
+#pragma once
+#include "machine_ir.h"
+#include <ostream>
+#include <vector>
+
+// Location masks for liveness: one bit per register plus the flags
+constexpr uint64_t regBit(Reg reg) { return uint64_t(1) << uint8_t(reg); }
+constexpr uint64_t FLAGS = uint64_t(1) << 32;
+
+// A matched window: the instructions and what is live after each one
+struct PeepholeWindow {
+    const MInst* insts;
+    const uint64_t* liveAfter;
+
+    bool dead(size_t k, uint64_t mask) const { return (liveAfter[k] & mask) == 0; }
+};
+
+// One row of the rule table: the opcode sequence a window must have,
+// a guard over its operands and liveness, and the replacement sequence.
+// Replacements must leave every location that is live after the window
+// as the original did.
+struct PeepholeRule {
+    const char* name;
+    std::vector<MOp> ops;
+    bool (*match)(const PeepholeWindow& w);
+    void (*rewrite)(const MInst* in, std::vector<MInst>& out);
+};
+
+const std::vector<PeepholeRule>& peepholeRules();
+
+struct PeepholeStats {
+    std::vector<uint32_t> applied; // per rule
+    uint32_t deadRemoved = 0;      // instructions whose results were never read
+    size_t before = 0, after = 0;
+};
+
+// Applies the rules in rounds, each followed by dead instruction removal,
+// until nothing changes. Memory is never considered dead.
+PeepholeStats runPeephole(MachineCode& code, const std::vector<PeepholeRule>& rules = peepholeRules());
+
+void printPeepholeReport(std::ostream& out, const std::vector<PeepholeRule>& rules, const PeepholeStats& stats);
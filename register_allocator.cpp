@@ -0,0 +1,157 @@
+// register_allocator.cpp
+#include "register_allocator.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace {
+
+constexpr Reg CALLER_SAVED[] = {Reg::rsi, Reg::rdi, Reg::r8, Reg::r9, Reg::r10, Reg::rcx};
+constexpr Reg CALLEE_SAVED[] = {Reg::rbx, Reg::r12, Reg::r13, Reg::r14, Reg::r15};
+// Every SSE register is caller-saved in the SysV ABI
+constexpr Reg DECIMAL_REGISTERS[] = {Reg::xmm1, Reg::xmm2, Reg::xmm3,  Reg::xmm4,  Reg::xmm5,  Reg::xmm6,  Reg::xmm7,
+                                     Reg::xmm8, Reg::xmm9, Reg::xmm10, Reg::xmm11, Reg::xmm12, Reg::xmm13, Reg::xmm14};
+
+bool isCalleeSaved(Reg reg) {
+    return std::find(std::begin(CALLEE_SAVED), std::end(CALLEE_SAVED), reg) != std::end(CALLEE_SAVED);
+}
+
+struct Interval {
+    uint32_t slot;
+    uint32_t start, end; // instruction positions, inclusive
+    bool crossesCall;
+    bool decimal;
+};
+
+} // namespace
+
+Allocation allocateRegisters(const TacCode& code) {
+    uint32_t slots = static_cast<uint32_t>(code.vars.size() + code.tempTypes.size());
+    Allocation allocation;
+    allocation.locations.assign(slots, Location());
+    if (code.size() == 0) return allocation;
+
+    // Intervals: every mention, widened over block boundaries where live
+    Cfg cfg(code);
+    Liveness live = computeLiveness(code, cfg);
+    std::vector<uint32_t> start(slots, Cfg::NONE), end(slots, 0);
+    auto cover = [&](uint32_t s, uint32_t position) {
+        start[s] = std::min(start[s], position);
+        end[s] = std::max(end[s], position);
+    };
+    for (uint32_t i = 0; i < code.size(); i++) {
+        for (Operand operand : {code.dst[i], code.lhs[i], code.rhs[i]}) {
+            uint32_t s = slotOf(code, operand);
+            if (s != Cfg::NONE) cover(s, i);
+        }
+    }
+    for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+        const BasicBlock& block = cfg.blocks[b];
+        if (block.begin == block.end) continue;
+        for (uint32_t g : live.liveIn[b]) cover(live.globals[g], block.begin);
+        for (uint32_t g : live.liveOut[b]) cover(live.globals[g], block.end - 1);
+    }
+
+    // Prints seen before each position, to spot intervals spanning a call
+    std::vector<uint32_t> prints(code.size() + 1, 0);
+    for (uint32_t i = 0; i < code.size(); i++) prints[i + 1] = prints[i] + (code.ops[i] == Opcode::Print);
+
+    std::vector<Interval> intervals;
+    for (uint32_t s = 0; s < slots; s++) {
+        if (start[s] == Cfg::NONE) continue;
+        bool crosses = end[s] > start[s] + 1 && prints[end[s]] - prints[start[s] + 1] > 0;
+        Type type = s < code.vars.size() ? code.vars[s].type : code.tempTypes[s - code.vars.size()];
+        intervals.push_back(Interval{s, start[s], end[s], crosses, type == Type::Decimal});
+    }
+    std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) {
+        return a.start != b.start ? a.start < b.start : a.slot < b.slot;
+    });
+    allocation.values = static_cast<uint32_t>(intervals.size());
+
+    // Free lists are used as stacks; reversed so the first listed goes first
+    std::vector<Reg> callerFree(std::rbegin(CALLER_SAVED), std::rend(CALLER_SAVED));
+    std::vector<Reg> calleeFree(std::rbegin(CALLEE_SAVED), std::rend(CALLEE_SAVED));
+    std::vector<Reg> decimalFree(std::rbegin(DECIMAL_REGISTERS), std::rend(DECIMAL_REGISTERS));
+    std::vector<const Interval*> active; // ascending by end
+    std::vector<const Interval*> spilled;
+    std::vector<bool> calleeUsed(32, false);
+
+    auto release = [&](Reg reg) { (isXmm(reg) ? decimalFree : isCalleeSaved(reg) ? calleeFree : callerFree).push_back(reg); };
+    auto activate = [&](const Interval* interval, Reg reg) {
+        allocation.locations[interval->slot].kind = Location::Register;
+        allocation.locations[interval->slot].reg = reg;
+        if (isCalleeSaved(reg)) calleeUsed[uint8_t(reg)] = true;
+        auto at = std::upper_bound(active.begin(), active.end(), interval,
+                                   [](const Interval* a, const Interval* b) { return a->end < b->end; });
+        active.insert(at, interval);
+    };
+
+    for (const Interval& current : intervals) {
+        while (!active.empty() && active.front()->end < current.start) {
+            release(allocation.locations[active.front()->slot].reg);
+            active.erase(active.begin());
+        }
+
+        std::vector<Reg>* pool = nullptr;
+        if (current.decimal) {
+            if (!current.crossesCall && !decimalFree.empty()) pool = &decimalFree;
+        } else if (!current.crossesCall && !callerFree.empty()) {
+            pool = &callerFree;
+        } else if (!calleeFree.empty()) {
+            pool = &calleeFree;
+        }
+        if (pool) {
+            Reg reg = pool->back();
+            pool->pop_back();
+            activate(&current, reg);
+            continue;
+        }
+
+        // Spill whichever usable interval of the same class ends last
+        const Interval* victim = nullptr;
+        for (auto it = active.rbegin(); it != active.rend(); ++it) {
+            Reg reg = allocation.locations[(*it)->slot].reg;
+            if (isXmm(reg) == current.decimal && (!current.crossesCall || isCalleeSaved(reg))) {
+                victim = *it;
+                break;
+            }
+        }
+        if (victim && victim->end > current.end) {
+            Reg reg = allocation.locations[victim->slot].reg;
+            active.erase(std::find(active.begin(), active.end(), victim));
+            spilled.push_back(victim);
+            activate(&current, reg);
+        } else {
+            spilled.push_back(&current);
+        }
+    }
+
+    // Spill slot coloring: a slot is reused once its last interval has ended
+    std::sort(spilled.begin(), spilled.end(), [](const Interval* a, const Interval* b) { return a->start < b->start; });
+    using Entry = std::pair<uint32_t, uint32_t>; // (end, slot) or (slot, unused)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> busy, freeSlots;
+    for (const Interval* interval : spilled) {
+        while (!busy.empty() && busy.top().first < interval->start) {
+            freeSlots.push({busy.top().second, 0});
+            busy.pop();
+        }
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = allocation.stackSlots++;
+        } else {
+            slot = freeSlots.top().first;
+            freeSlots.pop();
+        }
+        busy.push({interval->end, slot});
+        allocation.locations[interval->slot].kind = Location::Stack;
+        allocation.locations[interval->slot].slot = slot;
+    }
+    allocation.spilled = static_cast<uint32_t>(spilled.size());
+
+    for (Reg reg : CALLEE_SAVED) {
+        if (calleeUsed[uint8_t(reg)]) allocation.calleeSaved.push_back(reg);
+    }
+    return allocation;
+}
@@ -0,0 +1,40 @@
+// register_allocator.h
+#pragma once
+#include "machine_ir.h"
+#include "tac.h"
+#include <cstdint>
+#include <vector>
+
+struct Location {
+    enum Kind : uint8_t { None, Register, Stack } kind = None;
+    Reg reg = Reg::rax;
+    uint32_t slot = 0; // spill slot, 8 bytes each
+};
+
+struct Allocation {
+    std::vector<Location> locations; // per slot (variables, then temps; see dataflow.h)
+    std::vector<Reg> calleeSaved;    // callee-saved registers handed out
+    uint32_t stackSlots = 0;
+
+    uint32_t values = 0;  // slots with a live interval
+    uint32_t spilled = 0;
+};
+
+// Registers the code generator keeps for itself: rax and rdx for idiv,
+// setcc and memory-to-memory moves, r11 for wide immediates. rsp and rbp
+// hold the frame. xmm0 carries the decimal argument to the print helper
+// and converted operands; xmm15 holds decimal results bound for memory.
+constexpr Reg SCRATCH = Reg::rax;
+constexpr Reg SCRATCH_WIDE = Reg::r11;
+constexpr Reg SCRATCH_DECIMAL = Reg::xmm15;
+constexpr Reg SCRATCH_CONVERT = Reg::xmm0;
+
+// Linear-scan allocation (Poletto-Sarkar) of every TAC variable and temp
+// over the remaining general-purpose registers, or xmm1-xmm14 for
+// decimals. Each value gets one interval from its first to its last
+// mention, widened to the blocks it is live through. Values live across a
+// print call only take callee-saved registers; there are none for
+// decimals, so those are spilled. When registers run out the interval
+// ending last is spilled, and spilled intervals that do not overlap share
+// stack slots.
+Allocation allocateRegisters(const TacCode& code);
@@ -0,0 +1,82 @@
+// runtime.c
+// Freestanding runtime for objects written by --emit=obj: the process
+// entry point and the print and error helpers, on raw Linux system calls
+// with no libc. Output is buffered and flushed when full and at exit.
+//
+//   gcc -c -O2 -ffreestanding -fno-stack-protector -fno-builtin runtime.c
+//   ld -o program output.o runtime.o
+
+#include "runtime_format.h"
+
+typedef long long i64;
+typedef unsigned long long u64;
+
+int main(void);
+
+static char buffer[1 << 16];
+static u64 used;
+
+static i64 syscall3(i64 number, i64 a, i64 b, i64 c) {
+    i64 result;
+    __asm__ volatile("syscall" : "=a"(result) : "a"(number), "D"(a), "S"(b), "d"(c) : "rcx", "r11", "memory");
+    return result;
+}
+
+static void flush(void) {
+    u64 done = 0;
+    while (done < used) {
+        i64 w = syscall3(1, 1, (i64)(buffer + done), (i64)(used - done));
+        if (w <= 0) break;
+        done += (u64)w;
+    }
+    used = 0;
+}
+
+static void put(const char* text, u64 n) {
+    for (u64 i = 0; i < n; i++) {
+        if (used == sizeof(buffer)) flush();
+        buffer[used++] = text[i];
+    }
+}
+
+void __print_int(i64 v) {
+    char text[FORMAT_BUFFER];
+    int n = formatInteger(v, text);
+    text[n] = '\n';
+    put(text, (u64)n + 1);
+}
+
+void __print_string(const char* s) {
+    u64 n = 0;
+    while (s[n]) n++;
+    put(s, n);
+    put("\n", 1);
+}
+
+void __print_decimal(double value) {
+    char text[FORMAT_BUFFER];
+    int n = formatDecimal(value, text);
+    text[n] = '\n';
+    put(text, (u64)n + 1);
+}
+
+// Called by the code instead of dividing by zero; program output so far
+// is kept, as with the in-process runners
+void __division_by_zero(void) {
+    static const char message[] = "Runtime error: division by zero\n";
+    flush();
+    syscall3(1, 2, (i64)message, sizeof(message) - 1);
+    syscall3(60, 1, 0, 0);
+}
+
+void __runtime_start(void) {
+    int status = main();
+    flush();
+    syscall3(60, status, 0, 0);
+}
+
+__asm__(".globl _start\n"
+        "_start:\n"
+        "    xor %ebp, %ebp\n"
+        "    and $-16, %rsp\n"
+        "    call __runtime_start\n");
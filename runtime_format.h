@@ -0,0 +1,69 @@
+// runtime_format.h
+// Text forms of printed values, shared by runtime.c and the JIT helpers
+// so native and JIT runs print the same. Plain C with no library calls.
+#pragma once
+
+enum { FORMAT_BUFFER = 48 }; // enough for any value below
+
+static int formatUnsigned(unsigned long long v, char* out) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (int k = 0; k < n; k++) out[k] = digits[n - 1 - k];
+    return n;
+}
+
+static int formatInteger(long long v, char* out) {
+    if (v >= 0) return formatUnsigned((unsigned long long)v, out);
+    out[0] = '-';
+    return 1 + formatUnsigned(0 - (unsigned long long)v, out + 1);
+}
+
+// Fixed point with up to six fractional digits, trailing zeros dropped
+static int formatFixed(double v, char* out) {
+    unsigned long long scaled = (unsigned long long)(v * 1e6 + 0.5);
+    int n = formatUnsigned(scaled / 1000000, out);
+    unsigned long long fraction = scaled % 1000000;
+    if (!fraction) return n;
+    int digits = 6;
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        digits--;
+    }
+    out[n] = '.';
+    for (int k = digits; k > 0; k--) {
+        out[n + k] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return n + 1 + digits;
+}
+
+// Large magnitudes switch to d.dddddde+N
+static int formatDecimal(double v, char* out) {
+    int n = 0;
+    if (v != v) {
+        out[0] = 'n', out[1] = 'a', out[2] = 'n';
+        return 3;
+    }
+    if (v < 0) {
+        out[n++] = '-';
+        v = -v;
+    }
+    if (v - v != 0) {
+        out[n] = 'i', out[n + 1] = 'n', out[n + 2] = 'f';
+        return n + 3;
+    }
+    if (v < 1e12) return n + formatFixed(v, out + n);
+    int exponent = 0;
+    while (v >= 10) {
+        v /= 10;
+        exponent++;
+    }
+    n += formatFixed(v, out + n);
+    out[n++] = 'e';
+    out[n++] = '+';
+    return n + formatUnsigned((unsigned long long)exponent, out + n);
+}
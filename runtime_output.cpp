@@ -0,0 +1,44 @@
+// runtime_output.cpp
+#include "runtime_output.h"
+#include "runtime_format.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+std::string output;
+bool discarding = false;
+
+void emit(const char* text, size_t n) {
+    if (discarding) return;
+    output.append(text, n);
+    output += '\n';
+    if (output.size() >= (1 << 16)) flushOutput();
+}
+
+} // namespace
+
+void printInt(long long v) {
+    char text[FORMAT_BUFFER];
+    emit(text, size_t(formatInteger(v, text)));
+}
+
+void printString(const char* s) {
+    emit(s, std::strlen(s));
+}
+
+void printDecimal(double v) {
+    char text[FORMAT_BUFFER];
+    emit(text, size_t(formatDecimal(v, text)));
+}
+
+void flushOutput() {
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    std::fflush(stdout);
+    output.clear();
+}
+
+void discardOutput(bool discard) {
+    discarding = discard;
+}
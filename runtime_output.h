@@ -0,0 +1,12 @@
+// runtime_output.h
+#pragma once
+
+// Buffered stdout for programs run inside the compiler (the JIT and the
+// VM), one value per line in the text forms of runtime_format.h
+void printInt(long long v);
+void printString(const char* s);
+void printDecimal(double v);
+void flushOutput();
+
+// Benchmarks run programs repeatedly with their output thrown away
+void discardOutput(bool discard);
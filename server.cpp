@@ -0,0 +1,315 @@
+// server.cpp
+#include "server.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_HEADER_BYTES = 128;
+constexpr size_t MAX_SOURCE_BYTES = size_t(1) << 30;
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+// Buffered reads and whole writes on a socket it does not own
+class Connection {
+    int fd;
+    char buffer[16 * 1024];
+    size_t begin = 0, end = 0;
+
+    bool fill() {
+        for (;;) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            begin = 0;
+            end = size_t(n);
+            return true;
+        }
+    }
+
+public:
+    explicit Connection(int fd) : fd(fd) {}
+
+    // The next line without its '\n'; false at end of stream or if the
+    // line is too long to be a header
+    bool readLine(std::string& line) {
+        line.clear();
+        for (;;) {
+            if (begin == end && !fill()) return false;
+            const char* start = buffer + begin;
+            const char* newline = static_cast<const char*>(std::memchr(start, '\n', end - begin));
+            size_t n = newline ? size_t(newline - start) : end - begin;
+            line.append(start, n);
+            begin += n;
+            if (newline) {
+                begin++;
+                return true;
+            }
+            if (line.size() > MAX_HEADER_BYTES) return false;
+        }
+    }
+
+    bool read(std::string& data, size_t size) {
+        data.resize(size);
+        size_t got = std::min(size, end - begin);
+        std::memcpy(&data[0], buffer + begin, got);
+        begin += got;
+        while (got < size) {
+            ssize_t n = ::recv(fd, &data[got], size - got, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            got += size_t(n);
+        }
+        return true;
+    }
+
+    bool write(const std::string& data) {
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += size_t(n);
+        }
+        return true;
+    }
+};
+
+const char* emitName(Emit emit) {
+    return emit == Emit::Tac ? "tac" : emit == Emit::Asm ? "asm" : "obj";
+}
+
+bool parseEmit(const char* name, Emit& emit) {
+    for (Emit e : {Emit::Tac, Emit::Asm, Emit::Obj}) {
+        if (std::strcmp(name, emitName(e)) == 0) {
+            emit = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string encodeResult(const CompileResult& result) {
+    std::string reply = std::string(result.ok ? "ok " : "error ") + std::to_string(result.output.size()) + " " +
+                        std::to_string(result.diagnostics.size()) + "\n";
+    reply += result.output;
+    for (const Diagnostic& d : result.diagnostics) {
+        reply += std::to_string(d.line) + " " + std::to_string(d.column) + " " + std::to_string(d.message.size()) + "\n";
+        reply += d.message;
+    }
+    return reply;
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Whether a server answers on path
+bool answers(const sockaddr_un& address) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    bool ok = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Shared by the connection threads. Idle contexts are pooled rather than
+// tied to connections, so clients that connect once per compile still
+// land on a warm context.
+class Server {
+    std::mutex lock;
+    std::condition_variable closed;
+    std::vector<int> connections;
+    std::vector<std::unique_ptr<Compiler>> idle;
+
+    std::unique_ptr<Compiler> acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (idle.empty()) return std::unique_ptr<Compiler>(new Compiler);
+        std::unique_ptr<Compiler> compiler = std::move(idle.back());
+        idle.pop_back();
+        return compiler;
+    }
+
+    void release(std::unique_ptr<Compiler> compiler) {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(std::move(compiler));
+    }
+
+    // Closed under the lock so stop() never shuts down a reused descriptor
+    void finish(int fd) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (connections[i] == fd) {
+                connections[i] = connections.back();
+                connections.pop_back();
+                break;
+            }
+        }
+        ::close(fd);
+        closed.notify_all();
+    }
+
+    void serve(int fd) {
+        Connection connection(fd);
+        std::string header, source;
+        while (connection.readLine(header)) {
+            char kind[8];
+            int optLevel;
+            size_t size;
+            CompileOptions options;
+            if (std::sscanf(header.c_str(), "compile %7s %d %zu", kind, &optLevel, &size) != 3 ||
+                !parseEmit(kind, options.emit) || optLevel < 0 || optLevel > 2 || size > MAX_SOURCE_BYTES) {
+                // The stream cannot be resynchronized after a bad header
+                CompileResult bad;
+                bad.diagnostics.push_back(Diagnostic{0, 0, "Malformed request: " + header});
+                connection.write(encodeResult(bad));
+                break;
+            }
+            options.optLevel = optLevel;
+            if (!connection.read(source, size)) break;
+            std::unique_ptr<Compiler> compiler = acquire();
+            CompileResult result = compiler->compile(source, options);
+            release(std::move(compiler));
+            if (!connection.write(encodeResult(result))) break;
+        }
+        finish(fd);
+    }
+
+public:
+    void accept(int fd) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            connections.push_back(fd);
+        }
+        std::thread([this, fd] { serve(fd); }).detach();
+    }
+
+    // Ends every connection after its current request (an in-flight
+    // compile still sends its reply) and waits for the threads
+    void stop() {
+        std::unique_lock<std::mutex> guard(lock);
+        for (int fd : connections) ::shutdown(fd, SHUT_RD);
+        closed.wait(guard, [this] { return connections.empty(); });
+    }
+};
+
+} // namespace
+
+std::string defaultSocketPath() {
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime && *runtime) {
+        return std::string(runtime) + "/mini_compiler.sock";
+    }
+    return "/tmp/mini_compiler-" + std::to_string(::getuid()) + ".sock";
+}
+
+bool serveCompiler(const std::string& socketPath, std::ostream& log) {
+    sockaddr_un address;
+    if (!fillAddress(socketPath, address)) {
+        log << "Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    if (answers(address)) {
+        log << "A server is already listening on " << socketPath << std::endl;
+        return false;
+    }
+    ::unlink(socketPath.c_str()); // left behind by a server that died
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t mask = ::umask(077); // only this user may connect
+    bool bound = listener >= 0 && ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    ::umask(mask);
+    if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+        log << "Failed to listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) ::close(listener);
+        return false;
+    }
+
+    // No SA_RESTART, so a stop signal interrupts accept(). Connection
+    // threads start with the stop signals blocked, so they always land on
+    // this thread.
+    struct sigaction action {};
+    action.sa_handler = requestStop;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    sigset_t stopSignals, previous;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+
+    log << "Serving on " << socketPath << std::endl;
+    Server server;
+    while (!stopRequested) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR) log << "accept: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        ::pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+        server.accept(fd);
+        ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+    server.stop();
+    log << "Stopped" << std::endl;
+    return true;
+}
+
+bool compileRemote(const std::string& socketPath, std::string_view source, const CompileOptions& options,
+                   CompileResult& result, std::string& error) {
+    sockaddr_un address;
+    if (!fillAddress(socketPath, address)) {
+        error = "Socket path too long: " + socketPath;
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        error = "Failed to connect to " + socketPath + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    Connection connection(fd);
+    std::string request = std::string("compile ") + emitName(options.emit) + " " + std::to_string(options.optLevel) + " " +
+                          std::to_string(source.size()) + "\n";
+    request.append(source.data(), source.size());
+    std::string header;
+    char status[8];
+    size_t outputSize, count;
+    bool ok = connection.write(request) && connection.readLine(header) &&
+              std::sscanf(header.c_str(), "%7s %zu %zu", status, &outputSize, &count) == 3 &&
+              connection.read(result.output, outputSize);
+    result.ok = ok && std::strcmp(status, "ok") == 0;
+    result.diagnostics.clear();
+    for (size_t i = 0; ok && i < count; i++) {
+        Diagnostic d;
+        size_t size;
+        ok = connection.readLine(header) && std::sscanf(header.c_str(), "%u %u %zu", &d.line, &d.column, &size) == 3 &&
+             connection.read(d.message, size);
+        result.diagnostics.push_back(std::move(d));
+    }
+    ::close(fd);
+    if (!ok) error = "Malformed reply from " + socketPath;
+    return ok;
+}
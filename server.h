@@ -0,0 +1,28 @@
+// server.h
+#pragma once
+#include "compiler.h"
+#include <ostream>
+#include <string>
+
+// Compile server over a Unix domain socket. A connection carries any
+// number of requests, each answered in turn:
+//
+//   request   "compile <tac|asm|obj> <opt level> <source bytes>\n" source
+//   response  "<ok|error> <output bytes> <diagnostic count>\n" output
+//             then per diagnostic "<line> <column> <message bytes>\n" message
+//
+// Connections are served concurrently, one thread each. Compiler contexts
+// are pooled and reused across requests, so a request runs on a warm
+// arena and interner.
+
+std::string defaultSocketPath(); // $XDG_RUNTIME_DIR/mini_compiler.sock or /tmp/mini_compiler-<uid>.sock
+
+// Listens on socketPath until SIGINT or SIGTERM, then removes the socket.
+// Returns false with a message if the socket cannot be set up.
+bool serveCompiler(const std::string& socketPath, std::ostream& log);
+
+// Sends one request to a running server. Returns false with error set if
+// the server cannot be reached or the reply is malformed; compile errors
+// come back in result.
+bool compileRemote(const std::string& socketPath, std::string_view source, const CompileOptions& options,
+                   CompileResult& result, std::string& error);
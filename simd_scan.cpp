@@ -0,0 +1,174 @@
+// simd_scan.cpp
+#include "simd_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_SCAN_X86 1
+#endif
+
+namespace {
+
+inline bool isBlank(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+size_t whitespaceScalar(const char* p, size_t n, size_t i) {
+    while (i < n && isBlank((unsigned char)p[i])) i++;
+    return i;
+}
+
+size_t eitherScalar(const char* p, size_t n, size_t i, char a, char b) {
+    while (i < n && p[i] != a && p[i] != b) i++;
+    return i;
+}
+
+inline bool isStructural(char c) {
+    return c == '"' || c == '/' || c == ';' || c == '{' || c == '}';
+}
+
+size_t structuralScalar(const char* p, size_t n, size_t i) {
+    while (i < n && !isStructural(p[i])) i++;
+    return i;
+}
+
+#ifdef SIMD_SCAN_X86
+
+size_t whitespaceSse2(const char* p, size_t n) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i span = _mm_set1_epi8('\r' - '\t');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        // '\t'..'\r' is a contiguous range: c - '\t' <= 4 (unsigned)
+        __m128i rel = _mm_sub_epi8(v, tab);
+        __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(rel, span), rel);
+        __m128i blank = _mm_or_si128(ctl, _mm_cmpeq_epi8(v, space));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(blank)) & 0xFFFFu;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return whitespaceScalar(p, n, i);
+}
+
+size_t eitherSse2(const char* p, size_t n, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return eitherScalar(p, n, i, a, b);
+}
+
+size_t structuralSse2(const char* p, size_t n) {
+    const __m128i quote = _mm_set1_epi8('"'), slash = _mm_set1_epi8('/'), semi = _mm_set1_epi8(';');
+    const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, semi),
+                                                _mm_or_si128(_mm_cmpeq_epi8(v, open), _mm_cmpeq_epi8(v, close))));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return structuralScalar(p, n, i);
+}
+
+__attribute__((target("avx2")))
+size_t whitespaceAvx2(const char* p, size_t n) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i span = _mm256_set1_epi8('\r' - '\t');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i rel = _mm256_sub_epi8(v, tab);
+        __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(rel, span), rel);
+        __m256i blank = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, space));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return whitespaceScalar(p, n, i);
+}
+
+__attribute__((target("avx2")))
+size_t eitherAvx2(const char* p, size_t n, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return eitherScalar(p, n, i, a, b);
+}
+
+__attribute__((target("avx2")))
+size_t structuralAvx2(const char* p, size_t n) {
+    const __m256i quote = _mm256_set1_epi8('"'), slash = _mm256_set1_epi8('/'), semi = _mm256_set1_epi8(';');
+    const __m256i open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, semi),
+                                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, open), _mm256_cmpeq_epi8(v, close))));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return structuralScalar(p, n, i);
+}
+
+#endif // SIMD_SCAN_X86
+
+size_t whitespaceFallback(const char* p, size_t n) {
+    return whitespaceScalar(p, n, 0);
+}
+
+size_t eitherFallback(const char* p, size_t n, char a, char b) {
+    return eitherScalar(p, n, 0, a, b);
+}
+
+size_t structuralFallback(const char* p, size_t n) {
+    return structuralScalar(p, n, 0);
+}
+
+struct ScanDispatch {
+    size_t (*whitespace)(const char*, size_t);
+    size_t (*either)(const char*, size_t, char, char);
+    size_t (*structural)(const char*, size_t);
+};
+
+ScanDispatch selectScanners() {
+#ifdef SIMD_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {whitespaceAvx2, eitherAvx2, structuralAvx2};
+    if (__builtin_cpu_supports("sse2")) return {whitespaceSse2, eitherSse2, structuralSse2};
+#endif
+    return {whitespaceFallback, eitherFallback, structuralFallback};
+}
+
+const ScanDispatch scanners = selectScanners();
+
+} // namespace
+
+size_t scanPastWhitespace(const char* p, size_t n) {
+    // Most runs between tokens are a single space; skip the vector setup for them
+    size_t i = whitespaceScalar(p, n < 4 ? n : 4, 0);
+    if (i < 4 || i == n) return i;
+    return i + scanners.whitespace(p + i, n - i);
+}
+
+size_t scanForEither(const char* p, size_t n, char a, char b) {
+    return scanners.either(p, n, a, b);
+}
+
+size_t scanForStructural(const char* p, size_t n) {
+    return scanners.structural(p, n);
+}
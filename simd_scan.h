@@ -0,0 +1,18 @@
+// simd_scan.h
+#pragma once
+#include <cstddef>
+
+// Bulk byte scanners used by the lexer to skip whitespace runs, comment
+// bodies and string bodies. Each returns the offset of the first matching
+// byte in [p, p + n), or n if there is none. The AVX2 or SSE2 variant is
+// picked once at startup from the running CPU, with a scalar fallback.
+
+// First byte that is not ' ', '\t', '\n', '\v', '\f' or '\r'
+size_t scanPastWhitespace(const char* p, size_t n);
+
+// First byte equal to a or b
+size_t scanForEither(const char* p, size_t n, char a, char b);
+
+// First '"', '/', ';', '{' or '}': the bytes that open strings and
+// comments or end statements and blocks
+size_t scanForStructural(const char* p, size_t n);
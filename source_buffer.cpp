@@ -0,0 +1,52 @@
+// source_buffer.cpp
+#include "source_buffer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceBuffer::~SourceBuffer() {
+    if (mapped) munmap(const_cast<char*>(data), length);
+}
+
+bool SourceBuffer::readAll(int fd) {
+    char chunk[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        fallback.append(chunk, static_cast<size_t>(n));
+    }
+    if (n < 0) return false;
+    data = fallback.data();
+    length = fallback.size();
+    return true;
+}
+
+bool SourceBuffer::open(const std::string& path) {
+    if (path == "-") return readAll(STDIN_FILENO);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // Pipes, FIFOs and empty files cannot be mapped
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        bool ok = readAll(fd);
+        close(fd);
+        return ok;
+    }
+
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(addr);
+    length = static_cast<size_t>(st.st_size);
+    mapped = true;
+    return true;
+}
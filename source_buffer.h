@@ -0,0 +1,25 @@
+// source_buffer.h
+#pragma once
+#include <string>
+#include <string_view>
+
+// Read-only view of a source file. Regular files are memory-mapped so the
+// lexer can hand out tokens that point straight into the mapping; stdin and
+// pipes fall back to a single buffered read.
+class SourceBuffer {
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string fallback;
+
+    bool readAll(int fd);
+
+public:
+    SourceBuffer() = default;
+    ~SourceBuffer();
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    bool open(const std::string& path); // "-" reads stdin
+    std::string_view view() const { return std::string_view(data, length); }
+};
@@ -0,0 +1,269 @@
+// ssa.cpp
+#include "ssa.h"
+#include "dataflow.h"
+#include <utility>
+
+SsaForm buildSsa(TacCode& code, const Cfg& cfg) {
+    uint32_t blockCount = static_cast<uint32_t>(cfg.blocks.size());
+    uint32_t varCount = static_cast<uint32_t>(code.vars.size());
+    uint32_t slots = varCount + static_cast<uint32_t>(code.tempTypes.size());
+    Liveness live = computeLiveness(code, cfg);
+
+    SsaForm ssa;
+    ssa.phis.assign(blockCount, {});
+    ssa.keep.assign(code.size(), true);
+    ssa.firstVersion = static_cast<uint32_t>(code.tempTypes.size());
+    auto newVersion = [&](uint32_t s) {
+        ssa.origin.push_back(s);
+        return code.newTemp(code.typeOf(slotOperand(code, s)));
+    };
+
+    // Temps written once are already in SSA form and keep their names
+    std::vector<uint32_t> defCount(slots, 0);
+    std::vector<std::vector<uint32_t>> defBlocks(slots);
+    for (uint32_t b = 0; b < blockCount; b++) {
+        for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            uint32_t d = slotOf(code, code.dst[i]);
+            if (d == Cfg::NONE) continue;
+            defCount[d]++;
+            if (defBlocks[d].empty() || defBlocks[d].back() != b) defBlocks[d].push_back(b);
+        }
+    }
+    std::vector<bool> renamed(slots, false);
+    for (uint32_t s = 0; s < slots; s++) renamed[s] = s < varCount ? defCount[s] > 0 : defCount[s] > 1;
+
+    // Phi placement over the iterated dominance frontier of each global name
+    std::vector<uint32_t> hasPhi(blockCount, Cfg::NONE), queued(blockCount, Cfg::NONE);
+    std::vector<uint32_t> worklist;
+    for (uint32_t s : live.globals) {
+        if (!renamed[s]) continue;
+        for (uint32_t b : defBlocks[s]) {
+            queued[b] = s;
+            worklist.push_back(b);
+        }
+        while (!worklist.empty()) {
+            uint32_t b = worklist.back();
+            worklist.pop_back();
+            if (!cfg.reachable(b)) continue;
+            for (uint32_t f : cfg.frontier[b]) {
+                if (hasPhi[f] == s || !live.isLiveIn(f, s)) continue;
+                hasPhi[f] = s;
+                ssa.phis[f].push_back(Phi{s, newVersion(s),
+                                          std::vector<Operand>(cfg.blocks[f].preds.size(), slotOperand(code, s))});
+                if (queued[f] != s) {
+                    queued[f] = s;
+                    worklist.push_back(f);
+                }
+            }
+        }
+    }
+
+    // Renaming walks the dominator tree with an explicit stack; the log
+    // records pushes so each block can pop its own names on the way out
+    std::vector<std::vector<Operand>> current(slots);
+    std::vector<uint32_t> log;
+    auto rename = [&](Operand& operand) {
+        uint32_t s = slotOf(code, operand);
+        if (s != Cfg::NONE && renamed[s] && !current[s].empty()) operand = current[s].back();
+    };
+    auto define = [&](uint32_t s, Operand name) {
+        current[s].push_back(name);
+        log.push_back(s);
+    };
+
+    struct Frame {
+        uint32_t block;
+        size_t logMark;
+        size_t nextChild;
+    };
+    std::vector<Frame> stack{{0, 0, 0}};
+    bool entering = true;
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        uint32_t b = frame.block;
+        if (entering) {
+            frame.logMark = log.size();
+            for (const Phi& phi : ssa.phis[b]) define(phi.slot, phi.dst);
+            for (uint32_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+                rename(code.lhs[i]);
+                rename(code.rhs[i]);
+                uint32_t d = slotOf(code, code.dst[i]);
+                if (d != Cfg::NONE && renamed[d]) {
+                    code.dst[i] = newVersion(d);
+                    define(d, code.dst[i]);
+                }
+            }
+            for (uint32_t succ : cfg.blocks[b].succs) {
+                const std::vector<uint32_t>& preds = cfg.blocks[succ].preds;
+                size_t j = 0;
+                while (preds[j] != b) j++;
+                for (Phi& phi : ssa.phis[succ]) {
+                    if (!current[phi.slot].empty()) phi.args[j] = current[phi.slot].back();
+                }
+            }
+        }
+
+        if (frame.nextChild < cfg.domChildren[b].size()) {
+            uint32_t child = cfg.domChildren[b][frame.nextChild++];
+            stack.push_back(Frame{child, 0, 0});
+            entering = true;
+        } else {
+            while (log.size() > frame.logMark) {
+                current[log.back()].pop_back();
+                log.pop_back();
+            }
+            stack.pop_back();
+            entering = false;
+        }
+    }
+    return ssa;
+}
+
+namespace {
+
+bool isJump(Opcode op) {
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::IfTrue;
+}
+
+class SsaDestruction {
+    TacCode& code;
+    const Cfg& cfg;
+    const SsaForm& ssa;
+    TacCode out;     // only the instruction arrays are used
+    TacCode appendix; // split critical edges, placed after the program
+
+    void copy(TacCode& to, Operand d, Operand s) {
+        to.add(Opcode::Assign, d, s);
+    }
+
+    // The phis of succ read their values on the edge from block pred as
+    // one parallel copy: when a destination is also read as a source, all
+    // sources go through fresh temps first
+    void emitCopies(TacCode& to, uint32_t pred, uint32_t succ) {
+        const std::vector<uint32_t>& preds = cfg.blocks[succ].preds;
+        size_t j = 0;
+        while (preds[j] != pred) j++;
+
+        std::vector<std::pair<Operand, Operand>> moves;
+        for (const Phi& phi : ssa.phis[succ]) {
+            Operand d = original(phi.dst), s = original(phi.args[j]);
+            if (!phi.dst.isNone() && d != s) moves.push_back({d, s});
+        }
+        bool overlap = false;
+        for (size_t a = 0; a < moves.size() && !overlap; a++) {
+            for (size_t b = 0; b < moves.size(); b++) {
+                if (a != b && moves[a].first == moves[b].second) {
+                    overlap = true;
+                    break;
+                }
+            }
+        }
+        if (!overlap) {
+            for (auto& [d, s] : moves) copy(to, d, s);
+            return;
+        }
+        std::vector<Operand> staged;
+        for (auto& [d, s] : moves) {
+            staged.push_back(code.newTemp(code.typeOf(d)));
+            copy(to, staged.back(), s);
+        }
+        for (size_t k = 0; k < moves.size(); k++) copy(to, moves[k].first, staged[k]);
+    }
+
+    std::vector<bool> hasCopies; // per block
+
+    // True if some phi of block still needs a copy on an incoming edge
+    bool needsCopies(uint32_t block) const {
+        for (const Phi& phi : ssa.phis[block]) {
+            if (phi.dst.isNone()) continue;
+            Operand d = original(phi.dst);
+            for (Operand arg : phi.args) {
+                if (original(arg) != d) return true;
+            }
+        }
+        return false;
+    }
+
+    void emit(uint32_t i) {
+        out.add(code.ops[i], original(code.dst[i]), original(code.lhs[i]), original(code.rhs[i]));
+    }
+
+    Operand original(Operand operand) const {
+        return ssa.isVersion(operand) ? slotOperand(code, ssa.origin[operand.index() - ssa.firstVersion]) : operand;
+    }
+
+public:
+    SsaDestruction(TacCode& code, const Cfg& cfg, const SsaForm& ssa) : code(code), cfg(cfg), ssa(ssa) {}
+
+    void run() {
+        hasCopies.resize(cfg.blocks.size());
+        for (uint32_t b = 0; b < cfg.blocks.size(); b++) hasCopies[b] = needsCopies(b);
+        // Versions all map back to their original names, so the temps
+        // created for them can go before any copy temps are made
+        code.tempTypes.resize(ssa.firstVersion);
+
+        for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+            const BasicBlock& block = cfg.blocks[b];
+            bool terminated = block.end > block.begin && isJump(code.ops[block.end - 1]);
+            uint32_t bodyEnd = terminated ? block.end - 1 : block.end;
+            for (uint32_t i = block.begin; i < bodyEnd; i++) {
+                if (ssa.keep[i]) emit(i);
+            }
+            if (!cfg.reachable(b)) {
+                if (terminated) emit(bodyEnd);
+                continue;
+            }
+
+            Opcode last = terminated ? code.ops[bodyEnd] : Opcode::Label;
+            uint32_t target = terminated ? cfg.labelBlock[code.dst[bodyEnd].index()] : Cfg::NONE;
+            bool conditional = last == Opcode::IfFalse || last == Opcode::IfTrue;
+
+            if (conditional && target == b + 1) {
+                // Both edges lead to the next block: copy, then fall through
+                if (hasCopies[target]) emitCopies(out, b, target);
+                else emit(bodyEnd);
+                continue;
+            }
+            if (!conditional) {
+                // Single successor: copies go last, ahead of any goto
+                if (!block.succs.empty() && hasCopies[block.succs[0]]) emitCopies(out, b, block.succs[0]);
+                if (terminated) emit(bodyEnd);
+                continue;
+            }
+
+            // A conditional jump into a phi block is a critical edge: the
+            // jump is redirected through a block holding only its copies
+            emit(bodyEnd);
+            if (hasCopies[target]) {
+                Operand split = code.newLabel();
+                Operand label = out.dst.back();
+                out.dst.back() = split;
+                appendix.add(Opcode::Label, split);
+                emitCopies(appendix, b, target);
+                appendix.add(Opcode::Goto, label);
+            }
+            // The fall-through successor starts right after this block
+            if (b + 1 < cfg.blocks.size() && hasCopies[b + 1]) emitCopies(out, b, b + 1);
+        }
+
+        if (appendix.size() > 0) {
+            Operand end = code.newLabel();
+            out.add(Opcode::Goto, end);
+            for (size_t i = 0; i < appendix.size(); i++) {
+                out.add(appendix.ops[i], appendix.dst[i], appendix.lhs[i], appendix.rhs[i]);
+            }
+            out.add(Opcode::Label, end);
+        }
+
+        code.ops = std::move(out.ops);
+        code.dst = std::move(out.dst);
+        code.lhs = std::move(out.lhs);
+        code.rhs = std::move(out.rhs);
+    }
+};
+
+} // namespace
+
+void destroySsa(TacCode& code, const Cfg& cfg, const SsaForm& ssa) {
+    SsaDestruction(code, cfg, ssa).run();
+}
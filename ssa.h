@@ -0,0 +1,44 @@
+// ssa.h
+#pragma once
+#include "cfg.h"
+#include "tac.h"
+#include <cstdint>
+#include <vector>
+
+struct Phi {
+    uint32_t slot;              // variable or temp this phi merges
+    Operand dst;
+    std::vector<Operand> args;  // one per predecessor, in Cfg preds order
+};
+
+// SSA form lives in the TacCode itself: every definition of a variable, and
+// of any temp written more than once, is renamed to a fresh temp (a
+// version). The phis sit beside the code, per block. Instructions are never
+// moved while in SSA form; passes delete them by clearing keep instead.
+//
+// Passes must keep the form conventional: the versions of one name may not
+// be live at the same time, so never substitute one version for another or
+// move a version's definition past a use of its predecessor. Shortening
+// live ranges (substituting constants or single-definition temps, deleting
+// definitions) is always fine.
+struct SsaForm {
+    std::vector<std::vector<Phi>> phis; // per block; a phi with a None dst is dead
+    std::vector<bool> keep;
+    uint32_t firstVersion = 0;          // temps from here on are versions
+    std::vector<uint32_t> origin;       // version - firstVersion -> original slot
+
+    bool isVersion(Operand operand) const {
+        return operand.kind() == OperandKind::Temp && operand.index() >= firstVersion;
+    }
+};
+
+// Pruned SSA: phis are placed on the iterated dominance frontier of each
+// name's definitions, and only where the name is live. cfg must have
+// dominators and frontiers computed.
+SsaForm buildSsa(TacCode& code, const Cfg& cfg);
+
+// Renames every version back to its original name, then replaces the phis
+// that still need it by copies on the incoming edges, splitting critical
+// edges and sequencing each edge's copies as a parallel copy. Drops
+// instructions whose keep flag was cleared.
+void destroySsa(TacCode& code, const Cfg& cfg, const SsaForm& ssa);
@@ -1,18 +1,107 @@
 // symbol_table.cpp
 #include "symbol_table.h"
 
-void SymbolTable::insert(const std::string& name, const std::string& type) {
-    table[name] = type;
+const char* typeName(Type type) {
+    switch (type) {
+    case Type::Integer: return "integer";
+    case Type::Decimal: return "decimal";
+    case Type::String: return "string";
+    default: return "none";
+    }
 }
 
-bool SymbolTable::exists(const std::string& name) const {
-    return table.find(name) != table.end();
+namespace {
+
+inline size_t hashName(SymbolId name) {
+    return static_cast<size_t>(name * 0x9E3779B1u);
 }
 
-std::string SymbolTable::getType(const std::string& name) const {
-    auto it = table.find(name);
-    if (it != table.end()) {
-        return it->second;
+} // namespace
+
+SymbolTable::SymbolTable() : slots(64, 0) {
+    enterScope(); // global scope
+}
+
+// Slot holding name, or the empty slot where it would go
+size_t SymbolTable::findSlot(SymbolId name) const {
+    size_t mask = slots.size() - 1;
+    size_t i = hashName(name) & mask;
+    while (slots[i] != 0 && entries[slots[i] - 1].name != name) {
+        i = (i + 1) & mask;
     }
-    return "";
+    return i;
+}
+
+// Backward-shift deletion keeps probe sequences intact without tombstones
+void SymbolTable::removeSlot(size_t slot) {
+    size_t mask = slots.size() - 1;
+    size_t hole = slot;
+    size_t i = (slot + 1) & mask;
+    while (slots[i] != 0) {
+        size_t home = hashName(entries[slots[i] - 1].name) & mask;
+        // Move the entry back if its home does not lie in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+        i = (i + 1) & mask;
+    }
+    slots[hole] = 0;
+    occupied--;
+}
+
+void SymbolTable::grow() {
+    std::vector<uint32_t> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, 0);
+    for (uint32_t entry : old) {
+        if (entry != 0) slots[findSlot(entries[entry - 1].name)] = entry;
+    }
+}
+
+void SymbolTable::enterScope() {
+    scopeMarks.push_back(static_cast<uint32_t>(entries.size()));
+}
+
+void SymbolTable::exitScope() {
+    uint32_t mark = scopeMarks.back();
+    scopeMarks.pop_back();
+    while (entries.size() > mark) {
+        const Symbol& sym = entries.back();
+        size_t slot = findSlot(sym.name);
+        if (sym.shadowed != NONE) {
+            slots[slot] = sym.shadowed + 1;
+        } else {
+            removeSlot(slot);
+        }
+        entries.pop_back();
+    }
+}
+
+bool SymbolTable::insert(SymbolId name, Type type, VarId var) {
+    size_t slot = findSlot(name);
+    uint32_t shadowed = NONE;
+    if (slots[slot] != 0) {
+        shadowed = slots[slot] - 1;
+        if (shadowed >= scopeMarks.back()) return false;
+    } else {
+        occupied++;
+    }
+
+    entries.push_back(Symbol{name, type, var, shadowed});
+    slots[slot] = static_cast<uint32_t>(entries.size());
+
+    // Keep the load factor at or below 1/2
+    if (occupied * 2 > slots.size()) grow();
+    return true;
+}
+
+const Symbol* SymbolTable::lookup(SymbolId name) const {
+    uint32_t entry = slots[findSlot(name)];
+    return entry != 0 ? &entries[entry - 1] : nullptr;
+}
+
+bool SymbolTable::declaredInCurrentScope(SymbolId name) const {
+    uint32_t entry = slots[findSlot(name)];
+    return entry != 0 && entry - 1 >= scopeMarks.back();
 }
@@ -1,15 +1,52 @@
 // symbol_table.h
 #pragma once
-#include <string>
-#include <unordered_map>
+#include "interner.h"
+#include <vector>
 
+enum class Type : uint8_t {
+    None,
+    Integer,
+    Decimal,
+    String
+};
+
+const char* typeName(Type type);
+
+using VarId = uint32_t; // one per declaration, never reused
+
+struct Symbol {
+    SymbolId name;
+    Type type;
+    VarId var;
+    uint32_t shadowed; // entry this one hides in an outer scope, or NONE
+};
+
+// Lexically scoped symbol table. Declarations live on a stack partitioned
+// by scope marks; a flat open-addressing table maps each name to its
+// innermost declaration. Leaving a scope pops its entries and restores the
+// shadowed ones, so the cost is proportional to what the scope declared.
 class SymbolTable {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
 private:
-    std::unordered_map<std::string, std::string> table; // varName -> type
+    std::vector<Symbol> entries;      // declaration stack
+    std::vector<uint32_t> scopeMarks; // entries.size() when each scope opened
+    std::vector<uint32_t> slots;      // entry index + 1, 0 = empty
+    size_t occupied = 0;
+
+    size_t findSlot(SymbolId name) const;
+    void removeSlot(size_t slot);
+    void grow();
 
 public:
-    void insert(const std::string& name, const std::string& type);
-    bool exists(const std::string& name) const;
-    std::string getType(const std::string& name) const;
-};
+    SymbolTable();
+
+    void enterScope();
+    void exitScope();
 
+    // Returns false if name is already declared in the current scope
+    bool insert(SymbolId name, Type type, VarId var);
+    bool declaredInCurrentScope(SymbolId name) const;
+    const Symbol* lookup(SymbolId name) const;
+};
@@ -0,0 +1,146 @@
+// tac.cpp
+#include "tac.h"
+#include <charconv>
+#include <string>
+
+const char* opcodeSymbol(Opcode op) {
+    switch (op) {
+    case Opcode::Add: return "+";
+    case Opcode::Sub: return "-";
+    case Opcode::Mul: return "*";
+    case Opcode::Div: return "/";
+    case Opcode::Lt: return "<";
+    case Opcode::Gt: return ">";
+    case Opcode::Le: return "<=";
+    case Opcode::Ge: return ">=";
+    case Opcode::Eq: return "==";
+    case Opcode::Ne: return "!=";
+    default: return "";
+    }
+}
+
+bool isBinary(Opcode op) {
+    return op >= Opcode::Add && op <= Opcode::Ne;
+}
+
+bool isComparison(Opcode op) {
+    return op >= Opcode::Lt && op <= Opcode::Ne;
+}
+
+void TacCode::add(Opcode op, Operand d, Operand l, Operand r) {
+    ops.push_back(op);
+    dst.push_back(d);
+    lhs.push_back(l);
+    rhs.push_back(r);
+}
+
+void TacCode::compact(const std::vector<bool>& keep) {
+    size_t out = 0;
+    for (size_t i = 0; i < size(); i++) {
+        if (!keep[i]) continue;
+        ops[out] = ops[i];
+        dst[out] = dst[i];
+        lhs[out] = lhs[i];
+        rhs[out] = rhs[i];
+        out++;
+    }
+    ops.resize(out);
+    dst.resize(out);
+    lhs.resize(out);
+    rhs.resize(out);
+}
+
+Operand TacCode::newTemp(Type type) {
+    tempTypes.push_back(type);
+    return Operand(OperandKind::Temp, static_cast<uint32_t>(tempTypes.size() - 1));
+}
+
+Operand TacCode::newLabel() {
+    return Operand(OperandKind::Label, labelCount++);
+}
+
+Operand TacCode::constant(SymbolId text, Type type) {
+    uint64_t key = (uint64_t(text) << 8) | uint64_t(type);
+    auto it = constIndex.find(key);
+    if (it != constIndex.end()) return Operand(OperandKind::Const, it->second);
+
+    uint32_t index = static_cast<uint32_t>(consts.size());
+    consts.push_back(Constant{text, type});
+    constIndex.emplace(key, index);
+    return Operand(OperandKind::Const, index);
+}
+
+Type TacCode::typeOf(Operand operand) const {
+    switch (operand.kind()) {
+    case OperandKind::Temp: return tempTypes[operand.index()];
+    case OperandKind::Var: return vars[operand.index()].type;
+    case OperandKind::Const: return consts[operand.index()].type;
+    default: return Type::None;
+    }
+}
+
+namespace {
+
+void appendNumber(std::string& out, char prefix, uint32_t value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out += prefix;
+    out.append(digits, result.ptr);
+}
+
+void appendOperand(std::string& out, const TacCode& code, const Interner& interner, Operand operand) {
+    switch (operand.kind()) {
+    case OperandKind::Temp: appendNumber(out, 't', operand.index()); break;
+    case OperandKind::Var: out += interner.name(code.vars[operand.index()].name); break;
+    case OperandKind::Const: out += interner.name(code.consts[operand.index()].text); break;
+    case OperandKind::Label: appendNumber(out, 'L', operand.index()); break;
+    default: break;
+    }
+}
+
+} // namespace
+
+// Formats the whole listing into one buffer and writes it in a single call
+void TacCode::print(std::ostream& out, const Interner& interner) const {
+    std::string text;
+    text.reserve(size() * 16);
+    for (size_t i = 0; i < size(); i++) {
+        switch (ops[i]) {
+        case Opcode::Label:
+            appendOperand(text, *this, interner, dst[i]);
+            text += ':';
+            break;
+        case Opcode::Goto:
+            text += "goto ";
+            appendOperand(text, *this, interner, dst[i]);
+            break;
+        case Opcode::IfFalse:
+        case Opcode::IfTrue:
+            text += ops[i] == Opcode::IfFalse ? "ifFalse " : "if ";
+            appendOperand(text, *this, interner, lhs[i]);
+            text += " goto ";
+            appendOperand(text, *this, interner, dst[i]);
+            break;
+        case Opcode::Print:
+            text += "print ";
+            appendOperand(text, *this, interner, lhs[i]);
+            break;
+        case Opcode::Assign:
+            appendOperand(text, *this, interner, dst[i]);
+            text += " = ";
+            appendOperand(text, *this, interner, lhs[i]);
+            break;
+        default:
+            appendOperand(text, *this, interner, dst[i]);
+            text += " = ";
+            appendOperand(text, *this, interner, lhs[i]);
+            text += ' ';
+            text += opcodeSymbol(ops[i]);
+            text += ' ';
+            appendOperand(text, *this, interner, rhs[i]);
+            break;
+        }
+        text += '\n';
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
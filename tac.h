@@ -0,0 +1,93 @@
+// tac.h
+#pragma once
+#include "interner.h"
+#include "symbol_table.h"
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+enum class Opcode : uint8_t {
+    Assign,  // dst = lhs
+    Add,     // dst = lhs op rhs
+    Sub,
+    Mul,
+    Div,
+    Lt,
+    Gt,
+    Le,
+    Ge,
+    Eq,
+    Ne,
+    Label,   // dst:
+    Goto,    // goto dst
+    IfFalse, // ifFalse lhs goto dst
+    IfTrue,  // if lhs goto dst
+    Print    // print lhs
+};
+
+enum class OperandKind : uint8_t {
+    None,
+    Temp,
+    Var,
+    Const,
+    Label
+};
+
+// Typed 32-bit handle: kind in the top 3 bits, table index below
+struct Operand {
+    uint32_t bits = 0;
+
+    static constexpr uint32_t INDEX_BITS = 29;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    Operand() = default;
+    Operand(OperandKind kind, uint32_t index) : bits((uint32_t(kind) << INDEX_BITS) | index) {}
+
+    OperandKind kind() const { return OperandKind(bits >> INDEX_BITS); }
+    uint32_t index() const { return bits & INDEX_MASK; }
+    bool isNone() const { return bits == 0; }
+    bool operator==(Operand other) const { return bits == other.bits; }
+    bool operator!=(Operand other) const { return bits != other.bits; }
+};
+
+struct Constant {
+    SymbolId text; // spelling; strings are stored without quotes
+    Type type;
+};
+
+struct TacVar {
+    SymbolId name; // unique IR spelling
+    Type type;
+};
+
+const char* opcodeSymbol(Opcode op); // "+", "<", ... for binary opcodes
+bool isBinary(Opcode op);
+bool isComparison(Opcode op);
+
+// Three-address code in structure-of-arrays form: one opcode byte and
+// three 4-byte operand handles per instruction (13 bytes). Operands index
+// the temp, variable, constant and label tables below.
+struct TacCode {
+    std::vector<Opcode> ops;
+    std::vector<Operand> dst, lhs, rhs;
+
+    std::vector<Constant> consts;
+    std::vector<TacVar> vars;     // indexed by VarId
+    std::vector<Type> tempTypes;  // indexed by temp number
+    uint32_t labelCount = 0;
+
+    size_t size() const { return ops.size(); }
+    void add(Opcode op, Operand d, Operand l = Operand(), Operand r = Operand());
+    void compact(const std::vector<bool>& keep); // drops instructions with keep[i] == false
+
+    Operand newTemp(Type type);
+    Operand newLabel();
+    Operand constant(SymbolId text, Type type);
+    Type typeOf(Operand operand) const;
+
+    void print(std::ostream& out, const Interner& interner) const;
+
+private:
+    std::unordered_map<uint64_t, uint32_t> constIndex; // (text, type) -> const
+};
@@ -0,0 +1,203 @@
+// tac_file.cpp
+#include "tac_file.h"
+#include <charconv>
+
+namespace {
+
+size_t padded(size_t n) {
+    return (n + 3) & ~size_t(3);
+}
+
+void put32(std::string& image, uint32_t value) {
+    image.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void pad(std::string& image) {
+    image.resize(padded(image.size()), '\0');
+}
+
+} // namespace
+
+std::string tacFileImage(const TacCode& code, const Interner& interner) {
+    // File-local string table holding only the spellings the code references
+    std::vector<uint32_t> offsets{0};
+    std::string strings;
+    auto addString = [&](SymbolId id) {
+        std::string_view text = interner.name(id);
+        strings.append(text.data(), text.size());
+        offsets.push_back(static_cast<uint32_t>(strings.size()));
+        return static_cast<uint32_t>(offsets.size() - 2);
+    };
+
+    std::vector<uint32_t> constStrings, varStrings;
+    for (const auto& c : code.consts) constStrings.push_back(addString(c.text));
+    for (const auto& v : code.vars) varStrings.push_back(addString(v.name));
+
+    uint32_t n = static_cast<uint32_t>(code.size());
+    TacFileHeader header{};
+    header.magic = TAC_FILE_MAGIC;
+    header.version = TAC_FILE_VERSION;
+    header.instructionCount = n;
+    header.constCount = static_cast<uint32_t>(code.consts.size());
+    header.varCount = static_cast<uint32_t>(code.vars.size());
+    header.tempCount = static_cast<uint32_t>(code.tempTypes.size());
+    header.labelCount = code.labelCount;
+    header.stringCount = static_cast<uint32_t>(offsets.size() - 1);
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    std::string image;
+    image.reserve(sizeof(header) + 4 * offsets.size() + padded(strings.size()) + 8 * (header.constCount + header.varCount)
+                  + padded(header.tempCount) + padded(n) + 12 * size_t(n));
+    image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (uint32_t offset : offsets) put32(image, offset);
+    image += strings;
+    pad(image);
+    for (size_t i = 0; i < code.consts.size(); i++) {
+        put32(image, constStrings[i]);
+        put32(image, uint32_t(code.consts[i].type));
+    }
+    for (size_t i = 0; i < code.vars.size(); i++) {
+        put32(image, varStrings[i]);
+        put32(image, uint32_t(code.vars[i].type));
+    }
+    image.append(reinterpret_cast<const char*>(code.tempTypes.data()), code.tempTypes.size());
+    pad(image);
+    image.append(reinterpret_cast<const char*>(code.ops.data()), n);
+    pad(image);
+    image.append(reinterpret_cast<const char*>(code.dst.data()), 4 * size_t(n));
+    image.append(reinterpret_cast<const char*>(code.lhs.data()), 4 * size_t(n));
+    image.append(reinterpret_cast<const char*>(code.rhs.data()), 4 * size_t(n));
+
+    return image;
+}
+
+std::string_view TacFile::string(uint32_t index) const {
+    return std::string_view(stringData + stringOffsets[index], stringOffsets[index + 1] - stringOffsets[index]);
+}
+
+bool TacFile::openImage(std::string_view image) {
+    if (opened) return false;
+    opened = true;
+    return attach(image);
+}
+
+bool TacFile::attach(std::string_view image) {
+    if (image.size() < sizeof(TacFileHeader)) return false;
+
+    const char* base = image.data();
+    const TacFileHeader* h = reinterpret_cast<const TacFileHeader*>(base);
+    if (h->magic != TAC_FILE_MAGIC || h->version != TAC_FILE_VERSION) return false;
+
+    // Every table must lie inside the file before anything points at it
+    uint32_t n = h->instructionCount;
+    size_t offset = sizeof(TacFileHeader);
+    size_t stringTable = offset;
+    offset += 4 * (size_t(h->stringCount) + 1);
+    size_t stringBytes = offset;
+    offset += padded(h->stringBytes);
+    size_t constTable = offset;
+    offset += 8 * size_t(h->constCount);
+    size_t varTable = offset;
+    offset += 8 * size_t(h->varCount);
+    size_t tempTable = offset;
+    offset += padded(h->tempCount);
+    size_t opTable = offset;
+    offset += padded(n);
+    size_t operandTable = offset;
+    offset += 12 * size_t(n);
+    if (offset > image.size()) return false;
+
+    stringOffsets = reinterpret_cast<const uint32_t*>(base + stringTable);
+    stringData = base + stringBytes;
+    consts = reinterpret_cast<const uint32_t*>(base + constTable);
+    vars = reinterpret_cast<const uint32_t*>(base + varTable);
+    temps = reinterpret_cast<const Type*>(base + tempTable);
+    opcodes = reinterpret_cast<const Opcode*>(base + opTable);
+    dsts = reinterpret_cast<const Operand*>(base + operandTable);
+    lhss = dsts + n;
+    rhss = lhss + n;
+    if (!valid(*h)) return false;
+    header = h;
+    return true;
+}
+
+// Checks every index the loader and backend will follow, so a truncated
+// or corrupt file is rejected instead of read out of bounds
+bool TacFile::valid(const TacFileHeader& h) const {
+    auto validType = [](uint32_t t) { return t <= uint32_t(Type::String); };
+    if (stringOffsets[0] != 0 || stringOffsets[h.stringCount] != h.stringBytes) return false;
+    for (uint32_t i = 0; i < h.stringCount; i++) {
+        if (stringOffsets[i] > stringOffsets[i + 1]) return false;
+    }
+    for (const uint32_t* table : {consts, vars}) {
+        uint32_t count = table == consts ? h.constCount : h.varCount;
+        for (uint32_t i = 0; i < count; i++) {
+            if (table[2 * i] >= h.stringCount || !validType(table[2 * i + 1])) return false;
+        }
+    }
+    // Integer constants must fit in 64 bits, as the parser guarantees
+    for (uint32_t i = 0; i < h.constCount; i++) {
+        std::string_view text = constText(i);
+        int64_t value;
+        auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (constType(i) == Type::Integer && (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size())) return false;
+    }
+    for (uint32_t i = 0; i < h.tempCount; i++) {
+        if (!validType(uint32_t(temps[i]))) return false;
+    }
+
+    auto in = [&](Operand o, std::initializer_list<OperandKind> kinds) {
+        for (OperandKind kind : kinds) {
+            if (o.kind() != kind) continue;
+            switch (kind) {
+            case OperandKind::None: return o.isNone();
+            case OperandKind::Temp: return o.index() < h.tempCount;
+            case OperandKind::Var: return o.index() < h.varCount;
+            case OperandKind::Const: return o.index() < h.constCount;
+            case OperandKind::Label: return o.index() < h.labelCount;
+            }
+        }
+        return false;
+    };
+    constexpr OperandKind NONE = OperandKind::None, TEMP = OperandKind::Temp, VAR = OperandKind::Var,
+                          CONST = OperandKind::Const, LABEL = OperandKind::Label;
+    for (uint32_t i = 0; i < h.instructionCount; i++) {
+        Operand d = dsts[i], l = lhss[i], r = rhss[i];
+        bool ok;
+        switch (opcodes[i]) {
+        case Opcode::Assign:
+            ok = in(d, {TEMP, VAR}) && in(l, {TEMP, VAR, CONST}) && in(r, {NONE});
+            break;
+        case Opcode::Label:
+        case Opcode::Goto:
+            ok = in(d, {LABEL}) && in(l, {NONE}) && in(r, {NONE});
+            break;
+        case Opcode::IfFalse:
+        case Opcode::IfTrue:
+            ok = in(d, {LABEL}) && in(l, {TEMP, VAR, CONST}) && in(r, {NONE});
+            break;
+        case Opcode::Print:
+            ok = in(d, {NONE}) && in(l, {TEMP, VAR, CONST}) && in(r, {NONE});
+            break;
+        default:
+            ok = isBinary(opcodes[i]) && in(d, {TEMP, VAR}) && in(l, {TEMP, VAR, CONST}) && in(r, {TEMP, VAR, CONST});
+            break;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+void TacFile::load(TacCode& code, Interner& interner) const {
+    uint32_t n = size();
+    code.ops.assign(opcodes, opcodes + n);
+    code.dst.assign(dsts, dsts + n);
+    code.lhs.assign(lhss, lhss + n);
+    code.rhs.assign(rhss, rhss + n);
+    code.consts.clear();
+    for (uint32_t i = 0; i < header->constCount; i++) code.consts.push_back({interner.intern(constText(i)), constType(i)});
+    code.vars.clear();
+    for (uint32_t i = 0; i < header->varCount; i++) code.vars.push_back({interner.intern(varName(i)), varType(i)});
+    code.tempTypes.assign(temps, temps + header->tempCount);
+    code.labelCount = header->labelCount;
+}
@@ -0,0 +1,81 @@
+// tac_file.h
+#pragma once
+#include "interner.h"
+#include "tac.h"
+#include <string>
+
+// Versioned binary container for TacCode:
+//
+//   TacFileHeader
+//   uint32 stringOffsets[stringCount + 1]   string table index
+//   char   stringBytes[]                     padded to 4 bytes
+//   uint32 consts[constCount][2]             string index, Type
+//   uint32 vars[varCount][2]                 string index, Type
+//   uint8  tempTypes[tempCount]              padded to 4 bytes
+//   uint8  ops[instructionCount]             padded to 4 bytes
+//   uint32 dst[], lhs[], rhs[]               Operand bits, instructionCount each
+//
+// All integers are little-endian. The writer builds the image in memory; the
+// reader checks an image in place and reads from it without copying.
+
+constexpr uint32_t TAC_FILE_MAGIC = 0x31434154; // "TAC1"
+constexpr uint32_t TAC_FILE_VERSION = 1;
+
+struct TacFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t instructionCount;
+    uint32_t constCount;
+    uint32_t varCount;
+    uint32_t tempCount;
+    uint32_t labelCount;
+    uint32_t stringCount;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+
+std::string tacFileImage(const TacCode& code, const Interner& interner);
+
+// Read-only view over a mapped TAC file
+class TacFile {
+    const TacFileHeader* header = nullptr;
+    const uint32_t* stringOffsets = nullptr;
+    const char* stringData = nullptr;
+    const uint32_t* consts = nullptr;
+    const uint32_t* vars = nullptr;
+    const Type* temps = nullptr;
+    const Opcode* opcodes = nullptr;
+    const Operand* dsts = nullptr;
+    const Operand* lhss = nullptr;
+    const Operand* rhss = nullptr;
+
+    bool opened = false;
+
+    std::string_view string(uint32_t index) const;
+    bool attach(std::string_view image);
+    bool valid(const TacFileHeader& header) const;
+
+public:
+    // False if the image is not a well-formed TAC file: every offset, index
+    // and opcode is checked here, so load() can trust them. The caller keeps
+    // the image alive; a TacFile opens one image, a second openImage() fails.
+    bool openImage(std::string_view image);
+
+    uint32_t size() const { return header->instructionCount; }
+    Opcode op(uint32_t i) const { return opcodes[i]; }
+    Operand dst(uint32_t i) const { return dsts[i]; }
+    Operand lhs(uint32_t i) const { return lhss[i]; }
+    Operand rhs(uint32_t i) const { return rhss[i]; }
+
+    uint32_t varCount() const { return header->varCount; }
+    uint32_t tempCount() const { return header->tempCount; }
+    uint32_t labelCount() const { return header->labelCount; }
+    std::string_view constText(uint32_t i) const { return string(consts[2 * i]); }
+    Type constType(uint32_t i) const { return Type(consts[2 * i + 1]); }
+    std::string_view varName(uint32_t i) const { return string(vars[2 * i]); }
+    Type varType(uint32_t i) const { return Type(vars[2 * i + 1]); }
+    Type tempType(uint32_t i) const { return temps[i]; }
+
+    // Copies the mapped code into TacCode form, interning its spellings
+    void load(TacCode& code, Interner& interner) const;
+};
@@ -0,0 +1,45 @@
+// thread_pool.cpp
+#include "thread_pool.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+WorkStealingPool::WorkStealingPool(unsigned count) : threads(count ? count : std::thread::hardware_concurrency()) {
+    if (threads == 0) threads = 1;
+    queues.reset(new Queue[threads]);
+}
+
+bool WorkStealingPool::take(unsigned worker, size_t& index) {
+    {
+        Queue& own = queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.items.empty()) {
+            index = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+    for (unsigned k = 1; k < threads; k++) {
+        Queue& victim = queues[(worker + k) % threads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.items.empty()) {
+            index = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t index, unsigned worker)>& task) {
+    for (size_t i = 0; i < count; i++) queues[i % threads].items.push_back(i);
+    auto work = [&](unsigned worker) {
+        size_t index;
+        while (take(worker, index)) task(index, worker);
+    };
+    std::vector<std::thread> helpers;
+    unsigned started = unsigned(std::min<size_t>(threads, count));
+    for (unsigned w = 1; w < started; w++) helpers.emplace_back(work, w);
+    work(0);
+    for (std::thread& t : helpers) t.join();
+}
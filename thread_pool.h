@@ -0,0 +1,34 @@
+// thread_pool.h
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Work-stealing pool for batches of independent tasks. run() deals the
+// task indices round-robin into one deque per worker; each worker takes
+// from the front of its own deque and, once that is empty, steals from
+// the back of the others'. A worker's deque lock is only contended while
+// it is being stolen from. Tasks never add work, so a worker that finds
+// every deque empty is done.
+class WorkStealingPool {
+    struct alignas(64) Queue {
+        std::mutex lock;
+        std::deque<size_t> items;
+    };
+
+    unsigned threads;
+    std::unique_ptr<Queue[]> queues;
+
+    bool take(unsigned worker, size_t& index);
+
+public:
+    explicit WorkStealingPool(unsigned threads = 0); // 0: one per core
+
+    unsigned size() const { return threads; }
+
+    // Calls task(index, worker) for every index in [0, count) and returns
+    // when all are done. The caller runs as worker 0.
+    void run(size_t count, const std::function<void(size_t index, unsigned worker)>& task);
+};
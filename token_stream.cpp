@@ -0,0 +1,29 @@
+// token_stream.cpp
+#include "token_stream.h"
+
+TokenStream::TokenStream(Lexer& lexer) : lexer(&lexer) {}
+
+TokenStream::TokenStream(TokenBuffer& buffer) : buffer(&buffer) {}
+
+void TokenStream::fill(size_t n) {
+    while (count < n) {
+        ring[(head + count) & (LOOKAHEAD - 1)] = lexer ? lexer->getNextToken() : buffer->next();
+        count++;
+    }
+}
+
+const Token& TokenStream::peek(size_t offset) {
+    fill(offset + 1);
+    return ring[(head + offset) & (LOOKAHEAD - 1)];
+}
+
+Token TokenStream::next() {
+    fill(1);
+    Token token = ring[head];
+    // END_OF_FILE is sticky: keep it buffered so peek() stays valid
+    if (token.type != TokenType::END_OF_FILE) {
+        head = (head + 1) & (LOOKAHEAD - 1);
+        count--;
+    }
+    return token;
+}
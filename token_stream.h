@@ -0,0 +1,26 @@
+// token_stream.h
+#pragma once
+#include "lexer.h"
+#include "parallel_lexer.h"
+
+// Pulls tokens from a Lexer on demand through a small fixed-size ring
+// buffer, so the parser never holds more than LOOKAHEAD tokens at once.
+// It can also replay a TokenBuffer lexed ahead of time.
+class TokenStream {
+    static constexpr size_t LOOKAHEAD = 4; // must be a power of two
+
+    Lexer* lexer = nullptr;         // exactly one of lexer and buffer is set
+    TokenBuffer* buffer = nullptr;
+    Token ring[LOOKAHEAD];
+    size_t head = 0;  // slot of the current token
+    size_t count = 0; // buffered tokens starting at head
+
+    void fill(size_t n);
+
+public:
+    explicit TokenStream(Lexer& lexer);
+    explicit TokenStream(TokenBuffer& buffer);
+
+    const Token& peek(size_t offset = 0); // offset < LOOKAHEAD
+    Token next();
+};
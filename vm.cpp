@@ -0,0 +1,62 @@
+// vm.cpp
+#include "vm.h"
+#include "runtime_output.h"
+#include <cstring>
+
+namespace {
+
+#define R(field) regs[ip->field]
+
+#if defined(__GNUC__)
+// Direct threading: each handler ends in its own indirect jump, so the
+// branch predictor sees one jump site per opcode
+bool runThreaded(const BcInst* code, VmValue* regs, std::string& error) {
+    static const void* const handlers[] = {
+#define BYTECODE_LABEL(name) &&L_##name,
+        BYTECODE_OPS(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+    };
+    const BcInst* ip = code;
+#define OP(name) L_##name:
+#define NEXT() goto *handlers[uint32_t((++ip)->op)]
+#define JUMP(target) do { ip = code + (target); goto *handlers[uint32_t(ip->op)]; } while (0)
+    goto *handlers[uint32_t(ip->op)];
+#include "vm_ops.inc"
+#undef OP
+#undef NEXT
+#undef JUMP
+}
+#endif
+
+bool runSwitch(const BcInst* code, VmValue* regs, std::string& error) {
+    const BcInst* ip = code;
+#define OP(name) case BcOp::name:
+// Plain braces: continue must reach the loop, not a do-while
+#define NEXT() { ++ip; continue; }
+#define JUMP(target) { ip = code + (target); continue; }
+    for (;;) {
+        switch (ip->op) {
+#include "vm_ops.inc"
+        }
+    }
+#undef OP
+#undef NEXT
+#undef JUMP
+}
+
+#undef R
+
+} // namespace
+
+bool runBytecode(const Bytecode& bytecode, Dispatch dispatch, std::string& error) {
+    std::vector<VmValue> regs(bytecode.registers);
+    std::copy(bytecode.constants.begin(), bytecode.constants.end(), regs.begin() + bytecode.constantBase);
+    bool ok;
+#if defined(__GNUC__)
+    if (dispatch == Dispatch::Threaded) ok = runThreaded(bytecode.insts.data(), regs.data(), error);
+    else
+#endif
+        ok = runSwitch(bytecode.insts.data(), regs.data(), error);
+    flushOutput();
+    return ok;
+}
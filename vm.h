@@ -0,0 +1,13 @@
+// vm.h
+#pragma once
+#include "bytecode.h"
+#include <string>
+
+enum class Dispatch {
+    Threaded, // computed goto: every handler jumps straight to the next
+    Switch    // one switch in a loop, kept as the portable baseline
+};
+
+// Runs bytecode to completion, printing through runtime_output.h. On a
+// run-time error (integer division by zero) returns false with error set.
+bool runBytecode(const Bytecode& bytecode, Dispatch dispatch, std::string& error);
@@ -0,0 +1,316 @@
+// x86_encoder.cpp
+#include "x86_encoder.h"
+
+namespace {
+
+uint8_t number(Reg reg) {
+    return uint8_t(reg) & 15; // SSE registers number from 0 too
+}
+
+uint8_t low(Reg reg) {
+    return uint8_t(reg) & 7;
+}
+
+bool extended(Reg reg) {
+    return (uint8_t(reg) & 8) != 0;
+}
+
+// spl, bpl, sil and dil are only reachable with a REX prefix
+bool needsRex(const MOperand& o) {
+    return o.isReg() && o.bytes == 1 && uint8_t(o.reg) >= 4 && uint8_t(o.reg) < 8;
+}
+
+bool fitsInt8(int64_t v) {
+    return v == int64_t(int8_t(v));
+}
+
+// A branch left out of the first pass; its size is decided by relaxation
+struct Branch {
+    uint64_t offset; // in the text without branches
+    uint32_t label;
+    MOp op;
+    Cond cc;
+    bool longForm = false;
+
+    uint32_t size() const { return longForm ? (op == MOp::Jmp ? 5 : 6) : 2; }
+};
+
+class Encoder {
+    const MachineCode& code;
+    EncodedCode out;
+    std::string& text;
+    std::vector<Branch> branches;
+    std::vector<uint64_t> labelOffset;  // without branches
+    std::vector<uint32_t> labelBranches; // branches emitted before the label
+    std::vector<uint32_t> relocationBranches;
+
+    void byte(uint8_t b) { text.push_back(char(b)); }
+
+    void imm32(int64_t v) {
+        uint32_t u = uint32_t(int32_t(v));
+        for (int k = 0; k < 4; k++) byte(uint8_t(u >> (8 * k)));
+    }
+
+    void imm64(int64_t v) {
+        for (int k = 0; k < 8; k++) byte(uint8_t(uint64_t(v) >> (8 * k)));
+    }
+
+    void relocation(RelocationKind kind, uint32_t symbol, int64_t addend) {
+        out.relocations.push_back(Relocation{text.size(), kind, symbol, addend});
+        relocationBranches.push_back(uint32_t(branches.size()));
+        imm32(0);
+    }
+
+    // [rex] opcode modrm [disp]: reg is the ModRM reg field (a register or
+    // an opcode extension) and rm a register or memory operand. trailing
+    // counts immediate bytes after the displacement, which rip-relative
+    // addressing must skip.
+    void rm(std::initializer_list<uint8_t> opcode, bool wide, uint8_t reg, const MOperand& rm, int trailing = 0,
+            bool forceRex = false) {
+        uint8_t rex = uint8_t(0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | (rm.isReg() && extended(rm.reg) ? 1 : 0));
+        if (rex != 0x40 || forceRex || needsRex(rm)) byte(rex);
+        for (uint8_t b : opcode) byte(b);
+        uint8_t field = uint8_t((reg & 7) << 3);
+        switch (rm.kind) {
+        case MOperandKind::Reg:
+            byte(0xC0 | field | low(rm.reg));
+            break;
+        case MOperandKind::Stack: { // [rbp - d]
+            int64_t disp = -rm.value;
+            if (fitsInt8(disp)) {
+                byte(0x45 | field);
+                byte(uint8_t(disp));
+            } else {
+                byte(0x85 | field);
+                imm32(disp);
+            }
+            break;
+        }
+        case MOperandKind::Symbol: // [rip + symbol]
+            byte(0x05 | field);
+            relocation(RelocationKind::Pc32, uint32_t(rm.value), -4 - trailing);
+            break;
+        default:
+            break;
+        }
+    }
+
+    static bool wide(const MOperand& o) {
+        return !o.isReg() || o.bytes == 8;
+    }
+
+    // Scalar double operations: a mandatory prefix ahead of any REX, then
+    // 0F op /r with the SSE or integer register in the reg field
+    void sse(uint8_t prefix, uint8_t opcode, bool wide, Reg reg, const MOperand& operand) {
+        byte(prefix);
+        rm({0x0F, opcode}, wide, number(reg), operand);
+    }
+
+    // add, or, and, sub, xor and cmp share one encoding scheme
+    void alu(uint8_t n, const MInst& inst) {
+        const MOperand& a = inst.a;
+        const MOperand& b = inst.b;
+        if (b.isReg() && b.bytes == 1) { // byte forms, register to register only
+            rm({uint8_t(0x00 + 8 * n)}, false, uint8_t(b.reg), a, 0, needsRex(b));
+        } else if (b.isImm()) {
+            if (fitsInt8(b.value)) {
+                rm({0x83}, wide(a), n, a, 1);
+                byte(uint8_t(b.value));
+            } else {
+                rm({0x81}, wide(a), n, a, 4);
+                imm32(b.value);
+            }
+        } else if (b.isReg()) {
+            rm({uint8_t(0x01 + 8 * n)}, wide(b), uint8_t(b.reg), a, 0, needsRex(b));
+        } else {
+            rm({uint8_t(0x03 + 8 * n)}, wide(a), uint8_t(a.reg), b);
+        }
+    }
+
+    void imul3(const MOperand& a, const MOperand& b, int64_t c) {
+        if (fitsInt8(c)) {
+            rm({0x6B}, wide(a), uint8_t(a.reg), b, 1);
+            byte(uint8_t(c));
+        } else {
+            rm({0x69}, wide(a), uint8_t(a.reg), b, 4);
+            imm32(c);
+        }
+    }
+
+    void mov(const MOperand& a, const MOperand& b) {
+        if (a.isReg() && b.isImm()) {
+            uint8_t rex = extended(a.reg) ? 0x41 : 0;
+            if (a.bytes == 4 || (b.value >= 0 && b.value <= 0xFFFFFFFFll)) { // mov r32, imm32 zero-extends
+                if (rex) byte(rex);
+                byte(0xB8 + low(a.reg));
+                imm32(b.value);
+            } else if (b.fitsImm32()) {
+                rm({0xC7}, true, 0, a, 4);
+                imm32(b.value);
+            } else {
+                byte(0x48 | (rex & 1));
+                byte(0xB8 + low(a.reg));
+                imm64(b.value);
+            }
+        } else if (b.isImm()) {
+            rm({0xC7}, true, 0, a, 4);
+            imm32(b.value);
+        } else if (b.isReg()) {
+            rm({0x89}, wide(b), uint8_t(b.reg), a);
+        } else {
+            rm({0x8B}, wide(a), uint8_t(a.reg), b);
+        }
+    }
+
+    void branch(const MInst& inst) {
+        branches.push_back(Branch{text.size(), uint32_t(inst.a.value), inst.op, inst.cc});
+    }
+
+    void instruction(const MInst& inst) {
+        const MOperand& a = inst.a;
+        const MOperand& b = inst.b;
+        switch (inst.op) {
+        case MOp::Label: {
+            size_t label = size_t(a.value);
+            if (label >= labelOffset.size()) {
+                labelOffset.resize(label + 1, 0);
+                labelBranches.resize(label + 1, 0);
+            }
+            labelOffset[label] = text.size();
+            labelBranches[label] = uint32_t(branches.size());
+            break;
+        }
+        case MOp::Mov: mov(a, b); break;
+        case MOp::Movzx: rm({0x0F, 0xB6}, wide(a), uint8_t(a.reg), b); break;
+        case MOp::Lea: rm({0x8D}, true, uint8_t(a.reg), b); break;
+        case MOp::Add: alu(0, inst); break;
+        case MOp::Or: alu(1, inst); break;
+        case MOp::And: alu(4, inst); break;
+        case MOp::Sub: alu(5, inst); break;
+        case MOp::Xor: alu(6, inst); break;
+        case MOp::Cmp: alu(7, inst); break;
+        case MOp::Imul:
+            if (b.isImm()) imul3(a, a, b.value);
+            else rm({0x0F, 0xAF}, wide(a), uint8_t(a.reg), b);
+            break;
+        case MOp::Imul3: imul3(a, b, inst.c.value); break;
+        case MOp::Shl:
+        case MOp::Sar:
+            rm({0xC1}, wide(a), inst.op == MOp::Shl ? 4 : 7, a, 1);
+            byte(uint8_t(b.value));
+            break;
+        case MOp::Cqo: byte(0x48); byte(0x99); break;
+        case MOp::Idiv: rm({0xF7}, wide(a), 7, a); break;
+        case MOp::Test:
+            if (b.isImm()) {
+                rm({0xF7}, wide(a), 0, a, 4);
+                imm32(b.value);
+            } else {
+                rm({0x85}, wide(b), uint8_t(b.reg), a, 0, needsRex(b));
+            }
+            break;
+        case MOp::Setcc: rm({0x0F, uint8_t(0x90 + uint8_t(inst.cc))}, false, 0, a); break;
+        case MOp::Jmp:
+        case MOp::Jcc: branch(inst); break;
+        case MOp::Call:
+            byte(0xE8);
+            relocation(RelocationKind::Plt32, uint32_t(a.value), -4);
+            break;
+        case MOp::Push:
+        case MOp::Pop:
+            if (extended(a.reg)) byte(0x41);
+            byte(uint8_t((inst.op == MOp::Push ? 0x50 : 0x58) + low(a.reg)));
+            break;
+        case MOp::Movsd:
+            if (a.isReg()) sse(0xF2, 0x10, false, a.reg, b);
+            else sse(0xF2, 0x11, false, b.reg, a);
+            break;
+        case MOp::Addsd: sse(0xF2, 0x58, false, a.reg, b); break;
+        case MOp::Mulsd: sse(0xF2, 0x59, false, a.reg, b); break;
+        case MOp::Subsd: sse(0xF2, 0x5C, false, a.reg, b); break;
+        case MOp::Divsd: sse(0xF2, 0x5E, false, a.reg, b); break;
+        case MOp::Ucomisd: sse(0x66, 0x2E, false, a.reg, b); break;
+        case MOp::Cvtsi2sd: sse(0xF2, 0x2A, true, a.reg, b); break;
+        case MOp::Cvttsd2si: sse(0xF2, 0x2C, true, a.reg, b); break;
+        case MOp::Xorpd: sse(0x66, 0x57, false, a.reg, b); break;
+        case MOp::Leave: byte(0xC9); break;
+        case MOp::Ret: byte(0xC3); break;
+        }
+    }
+
+    // Grows branches to rel32 until every one reaches its target, then
+    // splices them into the text and shifts relocations to match
+    void relax() {
+        size_t n = branches.size();
+        std::vector<uint64_t> before(n + 1, 0); // branch bytes ahead of branch k
+        auto address = [&](uint64_t offset, uint32_t branchesBefore) { return offset + before[branchesBefore]; };
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t k = 0; k < n; k++) before[k + 1] = before[k] + branches[k].size();
+            for (size_t k = 0; k < n; k++) {
+                Branch& br = branches[k];
+                if (br.longForm) continue;
+                int64_t target = int64_t(address(labelOffset[br.label], labelBranches[br.label]));
+                int64_t end = int64_t(address(br.offset, uint32_t(k)) + br.size());
+                if (!fitsInt8(target - end)) br.longForm = changed = true;
+            }
+        }
+
+        std::string compact;
+        compact.swap(text);
+        text.reserve(compact.size() + before[n]);
+        uint64_t copied = 0;
+        for (size_t k = 0; k < n; k++) {
+            const Branch& br = branches[k];
+            text.append(compact, copied, br.offset - copied);
+            copied = br.offset;
+            int64_t target = int64_t(address(labelOffset[br.label], labelBranches[br.label]));
+            int64_t disp = target - int64_t(text.size() + br.size());
+            if (!br.longForm) {
+                byte(br.op == MOp::Jmp ? 0xEB : uint8_t(0x70 + uint8_t(br.cc)));
+                byte(uint8_t(disp));
+            } else if (br.op == MOp::Jmp) {
+                byte(0xE9);
+                imm32(disp);
+            } else {
+                byte(0x0F);
+                byte(uint8_t(0x80 + uint8_t(br.cc)));
+                imm32(disp);
+            }
+        }
+        text.append(compact, copied, std::string::npos);
+        for (size_t r = 0; r < out.relocations.size(); r++) {
+            out.relocations[r].offset = address(out.relocations[r].offset, relocationBranches[r]);
+        }
+    }
+
+    void layoutData() {
+        out.symbolOffset.assign(code.symbols.size(), 0);
+        for (size_t s = 0; s < code.symbols.size(); s++) {
+            const MachineCode::Symbol& symbol = code.symbols[s];
+            if (symbol.external) continue;
+            std::string& section = symbol.readOnly ? out.rodata : out.data;
+            section.resize((section.size() + symbol.align - 1) / symbol.align * symbol.align, '\0');
+            out.symbolOffset[s] = section.size();
+            section += symbol.bytes;
+        }
+    }
+
+public:
+    explicit Encoder(const MachineCode& code) : code(code), text(out.text) {}
+
+    EncodedCode run() {
+        text.reserve(code.insts.size() * 4);
+        for (const MInst& inst : code.insts) instruction(inst);
+        relax();
+        layoutData();
+        return std::move(out);
+    }
+};
+
+} // namespace
+
+EncodedCode encodeMachineCode(const MachineCode& code) {
+    return Encoder(code).run();
+}
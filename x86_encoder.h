@@ -0,0 +1,34 @@
+// x86_encoder.h
+#pragma once
+#include "machine_ir.h"
+#include <string>
+#include <vector>
+
+enum class RelocationKind : uint8_t {
+    Pc32,  // S + A - P, a rip-relative data reference
+    Plt32  // the same for a call to an external function
+};
+
+// A 32-bit field in the text to patch once the symbol is placed. The
+// addend is relative to the symbol's own start.
+struct Relocation {
+    uint64_t offset;
+    RelocationKind kind;
+    uint32_t symbol; // index into MachineCode::symbols
+    int64_t addend;
+};
+
+// Machine code bytes plus the data the code refers to. Data symbols are
+// laid out in rodata or data by their readOnly flag; symbolOffset gives
+// each one's offset in its section (external symbols have none).
+struct EncodedCode {
+    std::string text;
+    std::string rodata, data;
+    std::vector<uint64_t> symbolOffset;
+    std::vector<Relocation> relocations;
+    uint64_t entry = 0; // offset of the entry function in text
+};
+
+// Encodes code into x86-64 machine code. Labels are resolved here, and
+// branches take the short rel8 form wherever the target is in reach.
+EncodedCode encodeMachineCode(const MachineCode& code);